@@ -0,0 +1,61 @@
+//
+//  main.cpp
+//  server_clock_example
+//
+//  Created by king on 2024/11/17.
+//
+
+#include <sntp_client/server_clock.hpp>
+#include <sntp_client/sntp_client.hpp>
+
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+
+// 测量 Clock::now() 单次调用耗时（纳秒）
+template <typename Clock>
+static double benchmarkNow(int iterations) {
+    int64_t sink = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        sink += Clock::now().time_since_epoch().count();
+    }
+    auto end = std::chrono::steady_clock::now();
+    // 防止循环被优化掉
+    if (sink == 42) {
+        std::cerr << sink;
+    }
+    return std::chrono::duration<double, std::nano>(end - begin).count() / iterations;
+}
+
+int main(int argc, char *const argv[]) {
+
+    using namespace time_sync;
+
+    int iterations = argc > 1 ? atoi(argv[1]) : 10000000;
+
+    auto sntp = std::make_unique<SntpClient>();
+    sntp->setServer("ntp.aliyun.com");
+    sntp->addServer("ntp.tencent.com");
+    sntp->setTimeout(1);
+    sntp->setServerClockSource(true);
+    if (!sntp->sync()) {
+        std::cerr << "同步失败，server_clock 退化为 system_clock" << std::endl;
+    }
+
+    auto server_now = server_clock::now();
+    auto system_now = std::chrono::system_clock::now();
+    std::time_t t = server_clock::to_time_t(server_now);
+    std::cerr << "当前服务器时间: " << std::put_time(std::localtime(&t), "%Y-%m-%d %H:%M:%S")
+              << ", 与本机时间相差: "
+              << std::chrono::duration<double, std::milli>(server_clock::to_sys(server_now) - system_now).count() << "ms"
+              << std::endl;
+
+    std::cerr << std::fixed << std::setprecision(2)
+              << "server_clock::now(): " << benchmarkNow<server_clock>(iterations) << " ns/call" << std::endl
+              << "system_clock::now(): " << benchmarkNow<std::chrono::system_clock>(iterations) << " ns/call" << std::endl
+              << "steady_clock::now(): " << benchmarkNow<std::chrono::steady_clock>(iterations) << " ns/call" << std::endl;
+
+    return EXIT_SUCCESS;
+}
@@ -23,14 +23,20 @@ int main(int argc, char *const argv[]) {
     // Windows自带
     sntp->setServer("time.windows.com");
     // 苹果
-    sntp->setServer("time.apple.com");
+    sntp->addServer("time.apple.com");
     // 阿里云
-    sntp->setServer("ntp.aliyun.com");
+    sntp->addServer("ntp.aliyun.com");
     // 腾讯
-    sntp->setServer("ntp.tencent.com");
+    sntp->addServer("ntp.tencent.com");
     sntp->setVerbose(true);
     sntp->setTimeout(1);
 
+    // 可选：记录抓包文件，供 sntp_replay_example 离线回放
+    if (argc > 1 && !sntp->setCaptureFile(argv[1])) {
+        std::cerr << "无法打开抓包文件: " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+
     // 同步循环
     while (true) {
         if (sntp->needResync()) {
@@ -0,0 +1,87 @@
+//
+//  main.cpp
+//  sntp_replay_example
+//
+//  Created by king on 2024/11/17.
+//
+
+#include <sntp_client/sntp_client.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+struct ReplayStats {
+    bool quiet{false};
+    long valid{0};
+    long invalid{0};
+    long kissed{0};
+};
+
+static void onRecord(const time_sync::SntpReplayRecord &record, void *context) {
+    auto *stats = static_cast<ReplayStats *>(context);
+    if (record.status == time_sync::SntpReplayStatus::KissRate || record.status == time_sync::SntpReplayStatus::KissDeny) {
+        stats->kissed++;
+        if (!stats->quiet) {
+            std::cout << record.server << " kiss-o'-death " << record.kiss_code << std::endl;
+        }
+        return;
+    }
+    if (!record.valid) {
+        stats->invalid++;
+        if (!stats->quiet) {
+            std::cout << record.server << " invalid" << std::endl;
+        }
+        return;
+    }
+
+    stats->valid++;
+    if (!stats->quiet) {
+        std::cout << record.server
+                  << " boot=" << record.receive_elapsed_ms << "ms"
+                  << " offset=" << std::fixed << std::setprecision(3) << record.offset * 1000 << "ms"
+                  << " delay=" << record.delay * 1000 << "ms"
+                  << " stratum=" << record.stratum
+                  << " root_dispersion=" << record.root_dispersion * 1000 << "ms"
+                  << std::endl;
+    }
+}
+
+int main(int argc, char *const argv[]) {
+
+    using namespace time_sync;
+
+    if (argc < 2) {
+        std::cerr << "用法: " << argv[0] << " <抓包文件> [回放次数] [-q]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const char *path = argv[1];
+    int passes = argc > 2 ? atoi(argv[2]) : 1;
+    ReplayStats stats;
+    stats.quiet = argc > 3 && strcmp(argv[3], "-q") == 0;
+
+    auto sntp = std::make_unique<SntpClient>();
+
+    long records = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; i < passes; i++) {
+        long count = sntp->replayCapture(path, onRecord, &stats);
+        if (count < 0) {
+            std::cerr << "无法读取抓包文件或文件已损坏: " << path << std::endl;
+            return EXIT_FAILURE;
+        }
+        records += count;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double seconds = std::chrono::duration<double>(end - begin).count();
+    std::cerr << "回放 " << records << " 条记录 (有效 " << stats.valid << ", 无效 " << stats.invalid << ", KoD " << stats.kissed << ")"
+              << ", 耗时 " << std::fixed << std::setprecision(3) << seconds << "s"
+              << ", " << std::setprecision(0) << (seconds > 0 ? records / seconds : 0) << " records/s"
+              << std::endl;
+
+    return EXIT_SUCCESS;
+}
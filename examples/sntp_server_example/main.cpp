@@ -0,0 +1,122 @@
+//
+//  main.cpp
+//  sntp_server_example
+//
+//  Created by king on 2024/11/17.
+//
+
+#include <sntp_client/sntp_client.hpp>
+#include <sntp_client/sntp_server.hpp>
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+// 压测：向本机端口持续发送 mode 3 请求
+static void runLoadGenerator(uint16_t port, std::atomic<bool> &running) {
+    int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd < 0) {
+        return;
+    }
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(sockfd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) < 0) {
+        close(sockfd);
+        return;
+    }
+
+    uint8_t request[48] = {0};
+    request[0] = (3 << 3) | 3;  // VN 3, Mode 3
+    uint8_t reply[48];
+
+    while (running.load(std::memory_order_relaxed)) {
+        for (int i = 0; i < 32; i++) {
+            send(sockfd, request, sizeof(request), 0);
+        }
+        // 丢弃已收到的响应，避免接收缓冲区堆积
+        while (recv(sockfd, reply, sizeof(reply), MSG_DONTWAIT) > 0) {
+        }
+    }
+    close(sockfd);
+}
+
+int main(int argc, char *const argv[]) {
+
+    using namespace time_sync;
+
+    // 用法: sntp_server_example [端口] [线程数] [压测秒数]
+    uint16_t port = argc > 1 ? (uint16_t)atoi(argv[1]) : 123;
+    int threads = argc > 2 ? atoi(argv[2]) : 0;
+    int bench_seconds = argc > 3 ? atoi(argv[3]) : 0;
+
+    auto sntp = std::make_unique<SntpClient>();
+    sntp->setServer("ntp.aliyun.com");
+    sntp->setTimeout(1);
+    if (!sntp->sync()) {
+        // 未同步时仍然响应，但标记为未同步 (LI=3, INIT)
+        std::cerr << "同步失败，以未同步状态提供服务" << std::endl;
+    }
+
+    auto server = std::make_unique<SntpServer>(*sntp);
+    server->setPort(port);
+    server->setThreads(threads);
+    server->setVerbose(true);
+    if (!server->start()) {
+        std::cerr << "启动服务失败" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::atomic<bool> generating{bench_seconds > 0};
+    std::vector<std::thread> generators;
+    if (bench_seconds > 0) {
+        unsigned int count = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int i = 0; i < count; i++) {
+            generators.emplace_back(runLoadGenerator, port, std::ref(generating));
+        }
+    }
+
+    uint64_t last_requests = 0;
+    uint64_t last_responses = 0;
+    uint64_t total_pps = 0;
+    for (int second = 1; bench_seconds <= 0 || second <= bench_seconds; second++) {
+        if (sntp->needResync()) {
+            sntp->sync();
+        }
+
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+
+        uint64_t requests = server->getRequestCount();
+        uint64_t responses = server->getResponseCount();
+        total_pps += responses - last_responses;
+        std::cerr << "请求: " << requests - last_requests << " pps"
+                  << ", 响应: " << responses - last_responses << " pps"
+                  << ", 丢弃: " << server->getDroppedCount()
+                  << std::endl;
+        last_requests = requests;
+        last_responses = responses;
+    }
+
+    generating = false;
+    for (auto &generator : generators) {
+        generator.join();
+    }
+    server->stop();
+
+    if (bench_seconds > 0) {
+        std::cerr << "平均响应速率: " << total_pps / bench_seconds << " pps" << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
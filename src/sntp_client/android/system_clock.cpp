@@ -8,6 +8,7 @@
 #include "../system_clock.hpp"
 
 #include <sys/time.h>
+#include <time.h>
 
 namespace time_sync {
 
@@ -28,14 +29,23 @@ class AndroidSystemClock : public SystemClock {
 		return 0;
 	}
 
-	// 获取自启动以来的时间（毫秒）
+	// 获取自启动以来的时间（毫秒），包含休眠时间
 	uint64_t elapsedRealtime() override {
-		// temporary
-		return currentTimeMillis();
+		struct timespec times = {0, 0};
+		clock_gettime(CLOCK_BOOTTIME, &times);
+		return (uint64_t)times.tv_sec * 1000 + times.tv_nsec / 1000000;
+	}
+
+	// 获取自启动以来的时间（毫秒），不包含休眠时间
+	uint64_t uptimeMillis() override {
+		struct timespec times = {0, 0};
+		clock_gettime(CLOCK_MONOTONIC, &times);
+		return (uint64_t)times.tv_sec * 1000 + times.tv_nsec / 1000000;
 	}
 };
 
-std::unique_ptr<SystemClock> createSystemClock() {
-	return std::make_unique<AndroidSystemClock>();
+SystemClock &getSystemClock() {
+	static AndroidSystemClock clock;
+	return clock;
 }
 };  // namespace time_sync
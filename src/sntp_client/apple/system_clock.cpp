@@ -7,19 +7,15 @@
 
 #include "../system_clock.hpp"
 
-// #include <mach/mach_time.h>
-#include <sys/sysctl.h>
+#include <sys/time.h>
 #include <time.h>
 
 namespace time_sync {
 
 class AppleSystemClock : public SystemClock {
   private:
-	//    mach_timebase_info_data_t timebase_info_;
-
   public:
 	AppleSystemClock() {
-		//        mach_timebase_info(&timebase_info_);
 	}
 
 	~AppleSystemClock() = default;
@@ -33,31 +29,21 @@ class AppleSystemClock : public SystemClock {
 		return 0;
 	}
 
-	// 获取自启动以来的时间（毫秒）
+	// 获取自启动以来的时间（毫秒），包含休眠时间
+	// Darwin 的 CLOCK_MONOTONIC 基于 mach_continuous_time，休眠期间继续计时，且不受修改本机时间影响
 	uint64_t elapsedRealtime() override {
-		struct timeval boottime;
-		size_t size = sizeof(boottime);
-		int mib[2]  = {CTL_KERN, KERN_BOOTTIME};
-
-		if (sysctl(mib, 2, &boottime, &size, nullptr, 0) != -1) {
-			struct timeval now;
-			if (gettimeofday(&now, nullptr) != -1) {
-				// 计算当前时间和启动时间的差值
-				uint64_t seconds     = now.tv_sec - boottime.tv_sec;
-				int64_t microseconds = now.tv_usec - boottime.tv_usec;
-				return seconds * 1000 + microseconds / 1000;
-			}
-		}
-		return 0;
+		return clock_gettime_nsec_np(CLOCK_MONOTONIC) / 1000000;
+	}
 
-		// mach_absolute_time 在系统休眠时会被暂停，不适用
-		//        uint64_t absolute = mach_absolute_time();
-		//        uint64_t nanos = absolute * timebase_info_.numer / timebase_info_.denom;
-		//        return nanos / 1000000;  // 转换为毫秒
+	// 获取自启动以来的时间（毫秒），不包含休眠时间
+	// CLOCK_UPTIME_RAW 即 mach_absolute_time，系统休眠时暂停
+	uint64_t uptimeMillis() override {
+		return clock_gettime_nsec_np(CLOCK_UPTIME_RAW) / 1000000;
 	}
 };
 
-std::unique_ptr<SystemClock> createSystemClock() {
-	return std::make_unique<AppleSystemClock>();
+SystemClock &getSystemClock() {
+	static AppleSystemClock clock;
+	return clock;
 }
 };  // namespace time_sync
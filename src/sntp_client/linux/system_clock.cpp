@@ -29,16 +29,23 @@ class LinuxSystemClock : public SystemClock {
 		return 0;
 	}
 
-	// 获取自启动以来的时间（毫秒）
+	// 获取自启动以来的时间（毫秒），包含休眠时间
 	uint64_t elapsedRealtime() override {
+		struct timespec times = {0, 0};
+		clock_gettime(CLOCK_BOOTTIME, &times);
+		return (uint64_t)times.tv_sec * 1000 + times.tv_nsec / 1000000;
+	}
+
+	// 获取自启动以来的时间（毫秒），不包含休眠时间
+	uint64_t uptimeMillis() override {
 		struct timespec times = {0, 0};
 		clock_gettime(CLOCK_MONOTONIC, &times);
-		uint64_t ts = times.tv_sec * 1000 + times.tv_nsec / 1000000;
-		return ts;
+		return (uint64_t)times.tv_sec * 1000 + times.tv_nsec / 1000000;
 	}
 };
 
-std::unique_ptr<SystemClock> createSystemClock() {
-	return std::make_unique<LinuxSystemClock>();
+SystemClock &getSystemClock() {
+	static LinuxSystemClock clock;
+	return clock;
 }
 };  // namespace time_sync
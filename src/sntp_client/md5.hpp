@@ -0,0 +1,24 @@
+//
+//  md5.hpp
+//  sntp_client
+//
+//  Created by king on 2024/11/17.
+//
+
+#ifndef md5_hpp
+#define md5_hpp
+
+#include <cstddef>
+#include <cstdint>
+
+namespace time_sync {
+
+/// MD5 摘要 (RFC 1321)，仅用于按 RFC 5905 由 IPv6 地址生成 Reference ID，不可用于安全用途
+/// - Parameters:
+///   - data: 输入数据
+///   - size: 输入长度
+///   - digest: 输出16字节摘要
+void md5(const void *data, size_t size, uint8_t digest[16]);
+};  // namespace time_sync
+
+#endif /* md5_hpp */
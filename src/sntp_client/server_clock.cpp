@@ -0,0 +1,33 @@
+//
+//  server_clock.cpp
+//  sntp_client
+//
+//  Created by king on 2024/11/17.
+//
+
+#include "server_clock.hpp"
+
+#include <mutex>
+
+namespace time_sync {
+namespace detail {
+
+static std::mutex g_server_clock_mutex;
+
+void publishServerClock(int64_t server_ns, int64_t anchor_ns) {
+    std::lock_guard<std::mutex> lock(g_server_clock_mutex);
+    ServerClockSnapshot &snapshot = g_server_clock_snapshot;
+
+    uint32_t sequence = snapshot.sequence.load(std::memory_order_relaxed);
+    snapshot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    snapshot.anchor_ns.store(anchor_ns, std::memory_order_relaxed);
+    snapshot.server_ns.store(server_ns, std::memory_order_relaxed);
+
+    // 跳过 0，0 表示从未发布
+    uint32_t next = sequence + 2;
+    snapshot.sequence.store(next == 0 ? 2 : next, std::memory_order_release);
+}
+};  // namespace detail
+};  // namespace time_sync
@@ -0,0 +1,100 @@
+//
+//  server_clock.hpp
+//  sntp_client
+//
+//  Created by king on 2024/11/17.
+//
+
+#ifndef server_clock_hpp
+#define server_clock_hpp
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <time.h>
+
+namespace time_sync {
+
+namespace detail {
+
+/// 进程级的服务器时间基准，由 SntpClient 同步成功后发布，读取端为无锁 seqlock
+struct ServerClockSnapshot {
+    /// 奇数表示正在写入，0 表示从未发布
+    std::atomic<uint32_t> sequence{0};
+    /// 发布时刻的 anchorNowNanos()
+    std::atomic<int64_t> anchor_ns{0};
+    /// 同一时刻的服务器时间，Unix 时间（纳秒）
+    std::atomic<int64_t> server_ns{0};
+};
+
+inline ServerClockSnapshot g_server_clock_snapshot;
+
+/// 发布新的时间基准，多个写入方之间互斥
+void publishServerClock(int64_t server_ns, int64_t anchor_ns);
+
+/// 休眠期间继续计时、不受本机时间修改影响的单调时钟（纳秒），与 SystemClock::elapsedRealtime 同源
+inline int64_t anchorNowNanos() noexcept {
+#if defined(__linux__)
+    struct timespec ts;
+    clock_gettime(CLOCK_BOOTTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+#elif defined(__APPLE__)
+    return (int64_t)clock_gettime_nsec_np(CLOCK_MONOTONIC);
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+};  // namespace detail
+
+/// 满足 C++ Clock 要求的服务器时钟，纪元为 Unix 纪元
+/// 时间基准来自调用了 SntpClient::setServerClockSource(true) 的客户端最近一次同步；未同步时等同 system_clock
+struct server_clock {
+    using rep = int64_t;
+    using period = std::nano;
+    using duration = std::chrono::duration<rep, period>;
+    using time_point = std::chrono::time_point<server_clock>;
+    static constexpr bool is_steady = false;
+
+    static time_point now() noexcept {
+        const detail::ServerClockSnapshot &snapshot = detail::g_server_clock_snapshot;
+        uint32_t begin = 0;
+        int64_t anchor_ns = 0;
+        int64_t server_ns = 0;
+        do {
+            begin = snapshot.sequence.load(std::memory_order_acquire);
+            anchor_ns = snapshot.anchor_ns.load(std::memory_order_relaxed);
+            server_ns = snapshot.server_ns.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while ((begin & 1) || snapshot.sequence.load(std::memory_order_relaxed) != begin);
+
+        if (begin == 0) {
+            return from_sys(std::chrono::system_clock::now());
+        }
+        return time_point(duration(server_ns + (detail::anchorNowNanos() - anchor_ns)));
+    }
+
+    /// 是否已有客户端发布过时间基准
+    static bool is_synced() noexcept {
+        return detail::g_server_clock_snapshot.sequence.load(std::memory_order_acquire) != 0;
+    }
+
+    static std::chrono::system_clock::time_point to_sys(const time_point &t) noexcept {
+        return std::chrono::system_clock::time_point(std::chrono::duration_cast<std::chrono::system_clock::duration>(t.time_since_epoch()));
+    }
+
+    static time_point from_sys(const std::chrono::system_clock::time_point &t) noexcept {
+        return time_point(std::chrono::duration_cast<duration>(t.time_since_epoch()));
+    }
+
+    static std::time_t to_time_t(const time_point &t) noexcept {
+        return static_cast<std::time_t>(std::chrono::duration_cast<std::chrono::seconds>(t.time_since_epoch()).count());
+    }
+
+    static time_point from_time_t(std::time_t t) noexcept {
+        return time_point(std::chrono::seconds(t));
+    }
+};
+};  // namespace time_sync
+
+#endif /* server_clock_hpp */
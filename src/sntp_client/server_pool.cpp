@@ -0,0 +1,143 @@
+//
+//  server_pool.cpp
+//  sntp_client
+//
+//  Created by king on 2024/11/17.
+//
+
+#include "server_pool.hpp"
+
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace time_sync {
+
+// KoD RATE 的退避时长，每次连续收到翻倍
+constexpr uint64_t KOD_RATE_BACKOFF_MIN_MS = 64 * 1000;
+constexpr uint64_t KOD_RATE_BACKOFF_MAX_MS = 3600 * 1000;
+
+// 每次连续失败的扣分
+constexpr double FAILURE_PENALTY = 0.25;
+// 抖动相对延迟的扣分权重
+constexpr double JITTER_WEIGHT = 2.0;
+
+bool ServerPool::assign(ServerHealth &health, const char *server) {
+    size_t length = strlen(server);
+    if (length >= SERVER_NAME_MAX) {
+        return false;
+    }
+    health = ServerHealth();
+    memcpy(health.server, server, length + 1);
+    return true;
+}
+
+bool ServerPool::reset(const char *server) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    count_ = 0;
+    if (!assign(servers_[0], server)) {
+        return false;
+    }
+    count_ = 1;
+    return true;
+}
+
+bool ServerPool::add(const char *server) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int i = 0; i < count_; i++) {
+        ServerHealth &health = servers_[i];
+        if (strcmp(health.server, server) == 0) {
+            health.removed = false;
+            health.backoff_until = 0;
+            return true;
+        }
+    }
+    if (count_ >= SERVER_POOL_CAPACITY || !assign(servers_[count_], server)) {
+        return false;
+    }
+    count_++;
+    return true;
+}
+
+std::string ServerPool::key() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string key;
+    for (int i = 0; i < count_; i++) {
+        if (!key.empty()) {
+            key += ",";
+        }
+        key += servers_[i].server;
+    }
+    return key;
+}
+
+int ServerPool::select(uint64_t now, uint32_t tried, char *server, size_t size) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int best = -1;
+    double best_score = 0;
+    for (int i = 0; i < count_; i++) {
+        const ServerHealth &health = servers_[i];
+        if ((tried & (1u << i)) || health.removed || now < health.backoff_until) {
+            continue;
+        }
+        double value = score(health);
+        if (best < 0 || value > best_score) {
+            best = i;
+            best_score = value;
+        }
+    }
+    if (best >= 0) {
+        snprintf(server, size, "%s", servers_[best].server);
+    }
+    return best;
+}
+
+void ServerPool::report(int index, const char *server, SyncStatus status, double delay, uint64_t now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index < 0 || index >= count_ || strcmp(servers_[index].server, server) != 0) {
+        return;
+    }
+
+    ServerHealth &health = servers_[index];
+    health.reach = (uint8_t)(health.reach << 1);
+
+    switch (status) {
+    case SyncStatus::Success:
+        health.reach |= 1;
+        health.failures = 0;
+        health.rate_kisses = 0;
+        delay = std::max(delay, 0.0);
+        if (!health.has_rtt) {
+            health.rtt = delay;
+            health.jitter = 0;
+            health.has_rtt = true;
+        } else {
+            // 与 TCP RTT 估计相同的权重
+            health.jitter += (std::fabs(delay - health.rtt) - health.jitter) / 4;
+            health.rtt += (delay - health.rtt) / 8;
+        }
+        break;
+    case SyncStatus::Unreachable:
+    case SyncStatus::Invalid:
+        health.failures++;
+        break;
+    case SyncStatus::KissRate: {
+        health.failures++;
+        int shift = std::min(health.rate_kisses, 16);
+        health.backoff_until = now + std::min(KOD_RATE_BACKOFF_MIN_MS << shift, KOD_RATE_BACKOFF_MAX_MS);
+        health.rate_kisses++;
+        break;
+    }
+    case SyncStatus::KissDeny:
+        health.removed = true;
+        break;
+    }
+}
+
+double ServerPool::score(const ServerHealth &health) {
+    double reachability = std::bitset<8>(health.reach).count() / 8.0;
+    return reachability - health.rtt - JITTER_WEIGHT * health.jitter - FAILURE_PENALTY * health.failures;
+}
+};  // namespace time_sync
@@ -0,0 +1,101 @@
+//
+//  server_pool.hpp
+//  sntp_client
+//
+//  Created by king on 2024/11/17.
+//
+
+#ifndef server_pool_hpp
+#define server_pool_hpp
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace time_sync {
+
+// 服务器地址最大长度（含结尾的0）
+constexpr size_t SERVER_NAME_MAX = 256;
+// 服务器池容量，存储在池内不做堆分配
+constexpr int SERVER_POOL_CAPACITY = 8;
+
+/// 单次同步的结果分类，用于更新服务器健康度
+enum class SyncStatus {
+    Success,
+    /// 解析失败、发送失败或超时
+    Unreachable,
+    /// 响应未通过校验
+    Invalid,
+    /// Kiss-o'-Death RATE，请求过于频繁
+    KissRate,
+    /// Kiss-o'-Death DENY/RSTR，拒绝服务
+    KissDeny,
+};
+
+/// 服务器健康状态
+struct ServerHealth {
+    char server[SERVER_NAME_MAX]{};
+    /// 最近8次请求的可达性寄存器，最低位为最近一次
+    uint8_t reach{0};
+    /// 是否有过往返延迟样本
+    bool has_rtt{false};
+    /// 往返延迟的指数平均（秒）
+    double rtt{0};
+    /// 往返延迟抖动的指数平均（秒）
+    double jitter{0};
+    /// 连续失败次数
+    int failures{0};
+    /// 连续 KoD RATE 次数，决定退避时长
+    int rate_kisses{0};
+    /// 退避截止时间，elapsedRealtime（毫秒）
+    uint64_t backoff_until{0};
+    /// 收到 DENY/RSTR 后不再使用
+    bool removed{false};
+};
+
+/// 按可达性、延迟、抖动和校验失败给服务器打分，并根据 KoD 退避或移除服务器
+class ServerPool {
+  public:
+    /// 清空并只保留一个服务器
+    /// - Returns: 地址过长时返回 false
+    bool reset(const char *server);
+
+    /// 添加服务器，已存在时恢复其状态
+    /// - Returns: 地址过长或池已满时返回 false
+    bool add(const char *server);
+
+    /// 服务器列表，用于标识同一组服务器
+    std::string key() const;
+
+    /// 在本次同步未尝试过的可用服务器中选出得分最高的一个，得分相同时按添加顺序
+    /// - Parameters:
+    ///   - now: elapsedRealtime（毫秒）
+    ///   - tried: 本次同步已尝试的服务器下标位图
+    ///   - server: 输出服务器地址
+    ///   - size: server 缓冲区大小
+    /// - Returns: 服务器下标，没有可用服务器时返回 -1
+    int select(uint64_t now, uint32_t tried, char *server, size_t size) const;
+
+    /// 记录一次同步结果
+    /// - Parameters:
+    ///   - index: select 返回的下标
+    ///   - server: select 输出的服务器地址，期间服务器池被修改时忽略本次结果
+    ///   - status: 同步结果
+    ///   - delay: 往返延迟（秒），仅 Success 时有效
+    ///   - now: elapsedRealtime（毫秒）
+    void report(int index, const char *server, SyncStatus status, double delay, uint64_t now);
+
+    /// 得分越高越优先，范围 (-inf, 1]
+    static double score(const ServerHealth &health);
+
+  private:
+    static bool assign(ServerHealth &health, const char *server);
+
+    mutable std::mutex mutex_;
+    ServerHealth servers_[SERVER_POOL_CAPACITY];
+    int count_{0};
+};
+};  // namespace time_sync
+
+#endif /* server_pool_hpp */
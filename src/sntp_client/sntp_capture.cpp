@@ -0,0 +1,170 @@
+//
+//  sntp_capture.cpp
+//  sntp_client
+//
+//  Created by king on 2024/11/17.
+//
+
+#include "sntp_capture.hpp"
+
+#include "sntp_constants.hpp"
+
+#include <cstring>
+
+namespace time_sync {
+
+constexpr char CAPTURE_MAGIC[8] = {'S', 'N', 'T', 'P', 'C', 'A', 'P', 1};
+
+// 记录中除服务器地址外的固定部分：地址长度 + 请求 + 响应 + ref_id + 3个本地时间
+constexpr size_t CAPTURE_RECORD_FIXED_SIZE = 1 + NTP_PACKET_SIZE * 2 + 4 + 8 * 3;
+constexpr size_t CAPTURE_RECORD_MAX_SIZE = CAPTURE_RECORD_FIXED_SIZE + SERVER_NAME_MAX - 1;
+
+static_assert(sizeof(sntp_packet) == NTP_PACKET_SIZE, "sntp_packet must be packed");
+
+static uint8_t *putUint64(uint8_t *p, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        *p++ = (uint8_t)(value >> (i * 8));
+    }
+    return p;
+}
+
+static const uint8_t *getUint64(const uint8_t *p, uint64_t &value) {
+    value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= (uint64_t)*p++ << (i * 8);
+    }
+    return p;
+}
+
+CaptureWriter::~CaptureWriter() {
+    close();
+}
+
+bool CaptureWriter::open(const char *path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ != nullptr) {
+        fclose(file_);
+    }
+    file_ = fopen(path, "ab");
+    if (file_ == nullptr) {
+        return false;
+    }
+    fseek(file_, 0, SEEK_END);
+    if (ftell(file_) == 0 && fwrite(CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC), 1, file_) != 1) {
+        fclose(file_);
+        file_ = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void CaptureWriter::close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ != nullptr) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+bool CaptureWriter::isOpen() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_ != nullptr;
+}
+
+bool CaptureWriter::write(const char *server, const SntpExchange &exchange) {
+    size_t server_length = strnlen(server, SERVER_NAME_MAX - 1);
+    size_t size = CAPTURE_RECORD_FIXED_SIZE + server_length;
+
+    uint8_t buffer[2 + CAPTURE_RECORD_MAX_SIZE];
+    uint8_t *p = buffer;
+    *p++ = (uint8_t)(size & 0xff);
+    *p++ = (uint8_t)(size >> 8);
+    *p++ = (uint8_t)server_length;
+    memcpy(p, server, server_length);
+    p += server_length;
+    memcpy(p, &exchange.request, NTP_PACKET_SIZE);
+    p += NTP_PACKET_SIZE;
+    memcpy(p, &exchange.reply, NTP_PACKET_SIZE);
+    p += NTP_PACKET_SIZE;
+    memcpy(p, &exchange.ref_id, 4);
+    p += 4;
+    p = putUint64(p, exchange.receive_wall_ms);
+    p = putUint64(p, exchange.receive_elapsed_ms);
+    p = putUint64(p, exchange.receive_uptime_ms);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (file_ == nullptr) {
+        return false;
+    }
+    // 每条记录立即落盘，进程异常退出时不丢失已记录的交换
+    return fwrite(buffer, p - buffer, 1, file_) == 1 && fflush(file_) == 0;
+}
+
+CaptureReader::~CaptureReader() {
+    close();
+}
+
+bool CaptureReader::open(const char *path) {
+    close();
+    file_ = fopen(path, "rb");
+    if (file_ == nullptr) {
+        return false;
+    }
+    char magic[sizeof(CAPTURE_MAGIC)];
+    if (fread(magic, sizeof(magic), 1, file_) != 1 || memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void CaptureReader::close() {
+    if (file_ != nullptr) {
+        fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+CaptureReadResult CaptureReader::read(char server[SERVER_NAME_MAX], SntpExchange &exchange) {
+    if (file_ == nullptr) {
+        return CaptureReadResult::Corrupt;
+    }
+
+    uint8_t header[2];
+    size_t header_read = fread(header, 1, sizeof(header), file_);
+    if (header_read == 0 && feof(file_)) {
+        return CaptureReadResult::End;
+    }
+    if (header_read != sizeof(header)) {
+        return CaptureReadResult::Corrupt;
+    }
+    size_t size = header[0] | (header[1] << 8);
+    if (size < CAPTURE_RECORD_FIXED_SIZE || size > CAPTURE_RECORD_MAX_SIZE) {
+        return CaptureReadResult::Corrupt;
+    }
+
+    uint8_t buffer[CAPTURE_RECORD_MAX_SIZE];
+    if (fread(buffer, size, 1, file_) != 1) {
+        return CaptureReadResult::Corrupt;
+    }
+
+    const uint8_t *p = buffer;
+    size_t server_length = *p++;
+    if (server_length != size - CAPTURE_RECORD_FIXED_SIZE) {
+        return CaptureReadResult::Corrupt;
+    }
+    memcpy(server, p, server_length);
+    server[server_length] = '\0';
+    p += server_length;
+    memcpy(&exchange.request, p, NTP_PACKET_SIZE);
+    p += NTP_PACKET_SIZE;
+    memcpy(&exchange.reply, p, NTP_PACKET_SIZE);
+    p += NTP_PACKET_SIZE;
+    memcpy(&exchange.ref_id, p, 4);
+    p += 4;
+    p = getUint64(p, exchange.receive_wall_ms);
+    p = getUint64(p, exchange.receive_elapsed_ms);
+    getUint64(p, exchange.receive_uptime_ms);
+    return CaptureReadResult::Record;
+}
+};  // namespace time_sync
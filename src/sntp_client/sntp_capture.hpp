@@ -0,0 +1,81 @@
+//
+//  sntp_capture.hpp
+//  sntp_client
+//
+//  Created by king on 2024/11/17.
+//
+
+#ifndef sntp_capture_hpp
+#define sntp_capture_hpp
+
+#include "server_pool.hpp"
+#include "sntp_types.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+namespace time_sync {
+
+/// 一次完整的请求/响应交换，包含离线重新计算所需的全部本地时间
+struct SntpExchange {
+    /// 请求与响应，网络字节序原样保存
+    sntp_packet request;
+    sntp_packet reply;
+    /// 上游服务器标识（网络字节序）
+    uint32_t ref_id;
+    /// 收到响应时的本机时间、包含/不包含休眠的启动时间（毫秒）
+    uint64_t receive_wall_ms;
+    uint64_t receive_elapsed_ms;
+    uint64_t receive_uptime_ms;
+};
+
+/// 抓包文件写入
+/// 文件格式：8字节文件头 "SNTPCAP" + 版本号，随后为若干条记录；
+/// 每条记录为 2字节记录长度 + 1字节服务器地址长度 + 服务器地址 + 请求(48) + 响应(48) + ref_id(4) + 3个本地时间(各8)，整数均为小端序
+class CaptureWriter {
+  public:
+    ~CaptureWriter();
+
+    /// 以追加方式打开，新文件写入文件头
+    bool open(const char *path);
+
+    void close();
+
+    bool isOpen() const;
+
+    bool write(const char *server, const SntpExchange &exchange);
+
+  private:
+    mutable std::mutex mutex_;
+    FILE *file_{nullptr};
+};
+
+/// 读取单条记录的结果
+enum class CaptureReadResult {
+    Record,
+    /// 文件在记录边界处结束
+    End,
+    /// 记录被截断、长度不符或读取出错
+    Corrupt,
+};
+
+/// 抓包文件读取
+class CaptureReader {
+  public:
+    ~CaptureReader();
+
+    /// 打开并校验文件头
+    bool open(const char *path);
+
+    void close();
+
+    /// 读取下一条记录
+    CaptureReadResult read(char server[SERVER_NAME_MAX], SntpExchange &exchange);
+
+  private:
+    FILE *file_{nullptr};
+};
+};  // namespace time_sync
+
+#endif /* sntp_capture_hpp */
@@ -7,65 +7,147 @@
 
 #include "sntp_client.hpp"
 
+#include "md5.hpp"
+#include "server_clock.hpp"
+#include "server_pool.hpp"
+#include "sntp_capture.hpp"
+#include "sntp_constants.hpp"
 #include "sntp_types.h"
 #include "system_clock.hpp"
 
 #include <algorithm>
 #include <arpa/inet.h>
+#include <cerrno>
+#include <cmath>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
 #include <ctime>
-#include <iomanip>
+#include <mutex>
 #include <netdb.h>
 #include <netinet/in.h>
-#include <sstream>
+#include <new>
+#include <optional>
+#include <strings.h>
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <unistd.h>
 
-#include <vector>
-
-#include <iomanip>
-#include <iostream>
+#if !SNTP_CLIENT_MINIMAL
+#include <unordered_map>
+#endif
 
 namespace time_sync {
-// NTP时间从1900年开始,需要和Unix时间(1970年开始)转换
-constexpr uint64_t NTP_TIMESTAMP_DELTA = 2208988800ull;
-
-constexpr int NTP_PACKET_SIZE = 48;
 
-constexpr char STANDARD_NTP_PORT[] = "123";
-constexpr int NTP_MODE_CLIENT = 3;
-constexpr int NTP_MODE_SERVER = 4;
-constexpr int NTP_MODE_BROADCAST = 4;
-constexpr int NTP_VERSION = 3;
+struct TimeResult {
+    double offset;           // 时间偏移
+    double delay;            // 往返延迟
+    double sync_boot_time;   // 同步时的boottime（毫秒）
+    uint64_t sync_uptime;    // 同步时不含休眠的启动时间（毫秒）
+    uint64_t sync_wall_time; // 同步时的本机时间（毫秒）
+    double sync_time;        // 同步时的服务器时间（秒）
+    int stratum;             // 上游服务器层级
+    double root_delay;       // 本机到主参考源的总往返延迟（秒）
+    double root_dispersion;  // 同步时本机相对主参考源的离散度（秒）
+    uint32_t ref_id;         // 上游服务器标识（网络字节序）
+};
 
-constexpr int NTP_LEAP_NOSYNC = 3;
-constexpr int NTP_STRATUM_DEATH = 0;
-constexpr int NTP_STRATUM_MAX = 15;
+// 同步后休眠或虚拟机暂停超过该时长（毫秒）需要重新同步
+constexpr int64_t SUSPEND_RESYNC_THRESHOLD_MS = 1000;
+// 本机时间相对启动时间的跳变超过该值（毫秒）需要重新同步
+constexpr int64_t CLOCK_STEP_RESYNC_THRESHOLD_MS = 1000;
+// 本机时间允许的最大调频速率，避免把 NTP 守护进程的正常调频误判为跳变
+constexpr double CLOCK_SLEW_MAX = 500e-6;
+
+/// 单个服务器的一次同步结果，合并同步时由发起方记录，转交给其他客户端的服务器池
+struct PoolReport {
+    int index;
+    char server[SERVER_NAME_MAX];
+    SyncStatus status;
+    double delay;
+    uint64_t now;
+};
 
-struct TimeResult {
-    double offset;          // 时间偏移
-    double delay;           // 往返延迟
-    double sync_boot_time;  // 同步时的boottime（毫秒）
-    double sync_time;       // 同步时的服务器时间（秒）
+#if !SNTP_CLIENT_MINIMAL
+/// 跨客户端进行中的网络同步，并发的 sync() 调用等待并共享其结果
+struct SyncFlight {
+    /// 进程级注册表中的键
+    std::string registry_key;
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done{false};
+    std::optional<TimeResult> result;
+    /// 发起方对各服务器的同步结果，等待方据此更新自己的服务器池，使 KoD 退避/移除对所有客户端生效
+    PoolReport reports[SERVER_POOL_CAPACITY];
+    int report_count{0};
+    /// 发起方的服务器池，已直接记录结果，同一客户端的等待方不再重复记录
+    const ServerPool *leader_pool{nullptr};
 };
 
+/// 进程级的进行中同步，按服务器合并不同客户端的 sync()
+static std::mutex g_flight_registry_mutex;
+static std::unordered_map<std::string, std::weak_ptr<SyncFlight>> g_flight_registry;
+#endif
+
 class SntpClient::Implement {
   public:
-    std::unique_ptr<SystemClock> system_clock_;
-    std::string server_;
+    SystemClock &system_clock_;
+    ServerPool pool_;
     int timeout_sec_{1};
+    int max_attempts_{3};
     bool verbose_{false};
+    SntpClient::LogHandler log_handler_{nullptr};
+    void *log_context_{nullptr};
+    /// 是否与进程内其他客户端合并同一服务器的同步
+    bool shared_sync_{false};
+    /// 同步成功后是否发布为 server_clock 的时间基准
+    bool server_clock_source_{false};
+    /// 抓包记录
+    CaptureWriter capture_;
+    /// 本客户端是否有进行中的同步，等待者通过 sync_generation_ 的变化得知完成
+    bool syncing_{false};
+    uint64_t sync_generation_{0};
+    bool last_sync_succeeded_{false};
+    std::condition_variable sync_cond_;
     /// 同步时的boottime（毫秒）
     uint64_t base_boottime_{0};
+    /// 同步时不含休眠的启动时间（毫秒），用于检测休眠
+    uint64_t base_uptime_{0};
+    /// 同步时的本机时间（毫秒），用于检测本机时间跳变
+    uint64_t base_wall_time_{0};
     /// 同步时的服务器时间（秒）
     double base_server_time_{0};
+    /// 同步时的上游信息，供 SntpServer 转发
+    int base_stratum_{0};
+    double base_root_delay_{0};
+    double base_root_dispersion_{0};
+    uint32_t base_ref_id_{0};
     bool is_synced_{false};
+    /// 保护同步结果，sync() 与 SntpServer 工作线程可能并发访问
+    mutable std::mutex mutex_;
 
     Implement()
-        : system_clock_(createSystemClock()) {}
+        : system_clock_(getSystemClock()) {}
 
-    void setServer(const std::string &server) {
-        server_ = server;
+    bool setServer(const std::string &server) {
+        if (!pool_.reset(server.c_str())) {
+            log("server name too long: %s", server.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool addServer(const std::string &server) {
+        if (!pool_.add(server.c_str())) {
+            log("add server failed, pool is full or name too long: %s", server.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    void setMaxAttempts(int attempts) {
+        max_attempts_ = std::clamp(attempts, 1, SERVER_POOL_CAPACITY);
     }
 
     void setTimeout(int seconds) {
@@ -76,48 +158,153 @@ class SntpClient::Implement {
         verbose_ = verbose;
     }
 
-    void printNtpTimestamp(const char *prefix, const ntp_timestamp &ts, bool is_network_order = true) {
+    void setSharedSync(bool shared) {
+        shared_sync_ = shared;
+    }
+
+    void setServerClockSource(bool enable) {
+        server_clock_source_ = enable;
+        if (enable) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            publishServerClockLocked();
+        }
+    }
+
+    void publishServerClockLocked() const {
+        if (!is_synced_) {
+            return;
+        }
+        double server_time = base_server_time_ + (system_clock_.elapsedRealtime() - base_boottime_) / 1000.0;
+        detail::publishServerClock(llround(server_time * 1e9), detail::anchorNowNanos());
+    }
+
+    bool setCaptureFile(const std::string &path) {
+        if (path.empty()) {
+            capture_.close();
+            return true;
+        }
+        if (!capture_.open(path.c_str())) {
+            log("open capture file failed: %s", path.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    long replayCapture(const std::string &path, SntpClient::ReplayHandler handler, void *context) {
+        CaptureReader reader;
+        if (!reader.open(path.c_str())) {
+            log("open capture file failed: %s", path.c_str());
+            return -1;
+        }
+
+        long count = 0;
+        char server[SERVER_NAME_MAX];
+        SntpExchange exchange;
+        CaptureReadResult read_result;
+        while ((read_result = reader.read(server, exchange)) == CaptureReadResult::Record) {
+            SyncStatus status = SyncStatus::Invalid;
+            auto result = evaluateExchange(exchange, status);
+
+            SntpReplayRecord record;
+            record.server = server;
+            record.valid = result.has_value();
+            record.status = replayStatus(status);
+            if (status == SyncStatus::KissRate || status == SyncStatus::KissDeny) {
+                memcpy(record.kiss_code, exchange.reply.ref_id, sizeof(exchange.reply.ref_id));
+            }
+            if (result.has_value()) {
+                record.offset = result->offset;
+                record.delay = result->delay;
+                record.stratum = result->stratum;
+                record.root_delay = result->root_delay;
+                record.root_dispersion = result->root_dispersion;
+                record.server_time = result->sync_time;
+            }
+            record.receive_elapsed_ms = exchange.receive_elapsed_ms;
+            if (handler != nullptr) {
+                handler(record, context);
+            }
+            count++;
+        }
+        if (read_result == CaptureReadResult::Corrupt) {
+            log("capture file corrupt after %ld records: %s", count, path.c_str());
+            return -1;
+        }
+        return count;
+    }
+
+    static SntpReplayStatus replayStatus(SyncStatus status) {
+        switch (status) {
+        case SyncStatus::Success:
+            return SntpReplayStatus::Success;
+        case SyncStatus::KissRate:
+            return SntpReplayStatus::KissRate;
+        case SyncStatus::KissDeny:
+            return SntpReplayStatus::KissDeny;
+        default:
+            return SntpReplayStatus::Invalid;
+        }
+    }
+
+    void setLogHandler(SntpClient::LogHandler handler, void *context) {
+        log_handler_ = handler;
+        log_context_ = context;
+    }
+
+#if defined(__GNUC__) || defined(__clang__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    void log(const char *format, ...) const {
+        if (!verbose_) {
+            return;
+        }
+
+        char message[LOG_MESSAGE_MAX];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(message, sizeof(message), format, args);
+        va_end(args);
+
+        if (log_handler_ != nullptr) {
+            log_handler_(message, log_context_);
+        } else {
+            fprintf(stderr, "%s\n", message);
+        }
+    }
+
+    void printNtpTimestamp(const char *prefix, const ntp_timestamp &ts, bool is_network_order = true) const {
 
         uint32_t seconds = is_network_order ? ntohl(ts.seconds) : ts.seconds;
         uint32_t fraction = is_network_order ? ntohl(ts.fraction) : ts.fraction;
 
-        double timestamp = (seconds - NTP_TIMESTAMP_DELTA) + ((double)fraction / (1LL << 32));
-        time_t time = seconds - NTP_TIMESTAMP_DELTA;
-        std::cerr << prefix << ": "
-                  << getFormattedTime(time) << "." << std::setfill('0') << std::setw(9)
-                  << (uint32_t)((double)ts.fraction * 1000000000.0 / (1LL << 32))
-                  << " (" << seconds << "." << fraction << ")"
-                  << std::endl;
+        char formatted[32];
+        formatTime(seconds - NTP_TIMESTAMP_DELTA, formatted, sizeof(formatted));
+        log("%s: %s.%09u (%u.%u)", prefix, formatted,
+            (uint32_t)((double)fraction * 1000000000.0 / (1LL << 32)), seconds, fraction);
     }
 
-    void printSntpPacket(const char *prefix, const sntp_packet &packet, bool is_network_order = true) {
-        std::cerr << "=== " << prefix << " ===" << std::endl;
+    void printSntpPacket(const char *prefix, const sntp_packet &packet, bool is_network_order = true) const {
+        log("=== %s ===", prefix);
 
         // LI VN Mode
-        std::cerr << "LI: " << (int)packet.lvm.li
-                  << ", VN: " << (int)packet.lvm.vn
-                  << ", Mode: " << (int)packet.lvm.mode << std::endl;
+        log("LI: %d, VN: %d, Mode: %d", (int)packet.lvm.li, (int)packet.lvm.vn, (int)packet.lvm.mode);
 
         // Stratum
-        std::cerr << "Stratum: " << (int)packet.stratum;
+        const char *stratum_desc = "(reserved)";
         if (packet.stratum == 0) {
-            std::cerr << " (unspecified or invalid)";
+            stratum_desc = "(unspecified or invalid)";
         } else if (packet.stratum == 1) {
-            std::cerr << " (primary reference)";
+            stratum_desc = "(primary reference)";
         } else if (packet.stratum <= 15) {
-            std::cerr << " (secondary reference)";
-        } else {
-            std::cerr << " (reserved)";
+            stratum_desc = "(secondary reference)";
         }
-        std::cerr << std::endl;
+        log("Stratum: %d %s", (int)packet.stratum, stratum_desc);
 
         // Poll interval
-        std::cerr << "Poll Interval: " << (int)packet.poll
-                  << " (2^" << (int)packet.poll << " seconds)" << std::endl;
+        log("Poll Interval: %d (2^%d seconds)", (int)packet.poll, (int)packet.poll);
 
         // Precision
-        std::cerr << "Precision: " << (int)packet.precision
-                  << " (2^" << (int)packet.precision << " seconds)" << std::endl;
+        log("Precision: %d (2^%d seconds)", (int)packet.precision, (int)packet.precision);
 
         // Root Delay
         double root_delay = 0;
@@ -128,8 +315,7 @@ class SntpClient::Implement {
             root_delay = packet.root_delay_int +
                 packet.root_delay_fraction / 65536.0;
         }
-        std::cerr << "Root Delay: " << std::fixed << std::setprecision(6)
-                  << root_delay << " seconds" << std::endl;
+        log("Root Delay: %.6f seconds", root_delay);
 
         // Root Dispersion
         double root_dispersion = 0;
@@ -140,13 +326,12 @@ class SntpClient::Implement {
             root_dispersion = packet.root_dispersion_int +
                 packet.root_dispersion_fraction / 65536.0;
         }
-        std::cerr << "Root Dispersion: " << std::fixed << std::setprecision(6)
-                  << root_dispersion << " seconds" << std::endl;
+        log("Root Dispersion: %.6f seconds", root_dispersion);
 
         // Reference Identifier
         char refid[5] = {0};
         memcpy(refid, packet.ref_id, 4);
-        std::cerr << "Reference ID: " << refid << std::endl;
+        log("Reference ID: %s", refid);
 
         // Timestamps
         printNtpTimestamp("Reference Timestamp", packet.ref_time, is_network_order);
@@ -154,61 +339,188 @@ class SntpClient::Implement {
         printNtpTimestamp("Receive Timestamp", packet.recv_time, is_network_order);
         printNtpTimestamp("Transmit Timestamp", packet.tran_time, is_network_order);
 
-        std::cerr << "====================\n"
-                  << std::endl;
+        log("====================");
     }
 
     bool sync() {
-        auto result = syncOnce();
-        if (!result.has_value()) {
-            return false;
+#if !SNTP_CLIENT_MINIMAL
+        if (shared_sync_) {
+            return syncShared();
+        }
+#endif
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (syncing_) {
+            // 等待进行中的同步，结果已由发起方写入
+            uint64_t generation = sync_generation_;
+            sync_cond_.wait(lock, [this, generation] { return sync_generation_ != generation; });
+            return last_sync_succeeded_;
+        }
+        syncing_ = true;
+        lock.unlock();
+
+        auto result = syncPool();
+
+        lock.lock();
+        if (result.has_value()) {
+            applyResultLocked(*result);
         }
+        last_sync_succeeded_ = result.has_value();
+        syncing_ = false;
+        sync_generation_++;
+        sync_cond_.notify_all();
+        return last_sync_succeeded_;
+    }
 
-        base_boottime_ = result->sync_boot_time;
-        base_server_time_ = result->sync_time;
+    void applyResultLocked(const TimeResult &result) {
+        // 共享的结果可能早于本客户端已有的同步结果
+        if (is_synced_ && result.sync_boot_time < base_boottime_) {
+            return;
+        }
+        base_boottime_ = result.sync_boot_time;
+        base_uptime_ = result.sync_uptime;
+        base_wall_time_ = result.sync_wall_time;
+        base_server_time_ = result.sync_time;
+        base_stratum_ = result.stratum;
+        base_root_delay_ = result.root_delay;
+        base_root_dispersion_ = result.root_dispersion;
+        base_ref_id_ = result.ref_id;
         is_synced_ = true;
 
+        if (server_clock_source_) {
+            publishServerClockLocked();
+        }
+    }
+
+#if !SNTP_CLIENT_MINIMAL
+    /// 与进程内配置了相同服务器的客户端共享同一次同步
+    bool syncShared() {
+        std::shared_ptr<SyncFlight> flight;
+        bool leader = false;
+        {
+            std::lock_guard<std::mutex> lock(g_flight_registry_mutex);
+            std::string key = pool_.key();
+            std::weak_ptr<SyncFlight> &entry = g_flight_registry[key];
+            flight = entry.lock();
+            if (!flight) {
+                flight = std::make_shared<SyncFlight>();
+                flight->registry_key = key;
+                flight->leader_pool = &pool_;
+                entry = flight;
+                leader = true;
+            }
+        }
+
+        if (leader) {
+            auto result = syncPool(flight->reports, &flight->report_count);
+            {
+                // 先摘除，之后的 sync() 会发起新的同步
+                std::lock_guard<std::mutex> lock(g_flight_registry_mutex);
+                auto it = g_flight_registry.find(flight->registry_key);
+                if (it != g_flight_registry.end() && it->second.lock() == flight) {
+                    g_flight_registry.erase(it);
+                }
+            }
+            std::lock_guard<std::mutex> lock(flight->mutex);
+            flight->result = std::move(result);
+            flight->done = true;
+            flight->cond.notify_all();
+        } else {
+            std::unique_lock<std::mutex> lock(flight->mutex);
+            flight->cond.wait(lock, [&flight] { return flight->done; });
+            lock.unlock();
+
+            // 服务器列表相同，下标一致；期间服务器池被修改时 report 按地址忽略
+            for (int i = 0; flight->leader_pool != &pool_ && i < flight->report_count; i++) {
+                const PoolReport &report = flight->reports[i];
+                pool_.report(report.index, report.server, report.status, report.delay, report.now);
+            }
+        }
+
+        if (!flight->result.has_value()) {
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        applyResultLocked(*flight->result);
         return true;
     }
+#endif
+
+    /// 按得分依次尝试服务器，直到成功或达到最大尝试次数
+    /// - Parameters:
+    ///   - reports: 非空时额外记录每个服务器的同步结果，容量为 SERVER_POOL_CAPACITY
+    ///   - report_count: 记录的条数
+    std::optional<TimeResult> syncPool(PoolReport *reports = nullptr, int *report_count = nullptr) {
+        uint32_t tried = 0;
+        char server[SERVER_NAME_MAX];
+        for (int attempt = 0; attempt < max_attempts_; attempt++) {
+            int index = pool_.select(system_clock_.elapsedRealtime(), tried, server, sizeof(server));
+            if (index < 0) {
+                if (attempt == 0) {
+                    log("no available server");
+                }
+                break;
+            }
+            tried |= 1u << index;
+
+            SyncStatus status = SyncStatus::Unreachable;
+            auto result = syncOnce(server, status);
+            double delay = result.has_value() ? result->delay : 0;
+            uint64_t now = system_clock_.elapsedRealtime();
+            pool_.report(index, server, status, delay, now);
+            if (reports != nullptr) {
+                PoolReport &report = reports[(*report_count)++];
+                report.index = index;
+                memcpy(report.server, server, sizeof(report.server));
+                report.status = status;
+                report.delay = delay;
+                report.now = now;
+            }
+            if (result.has_value()) {
+                return result;
+            }
+        }
+        return std::nullopt;
+    }
 
-    std::optional<TimeResult> syncOnce() {
+    std::optional<TimeResult> syncOnce(const char *server, SyncStatus &status) {
+
+        log("sync with %s", server);
+
+        status = SyncStatus::Unreachable;
 
         // 解析服务器地址
         struct addrinfo hints = {}, *servinfo;
         hints.ai_family = AF_UNSPEC;
         hints.ai_socktype = SOCK_DGRAM;
 
-        if (getaddrinfo(server_.c_str(), STANDARD_NTP_PORT, &hints, &servinfo) != 0) {
-            if (verbose_) {
-                std::cerr << "getaddrinfo fail" << std::endl;
-            }
+        if (getaddrinfo(server, STANDARD_NTP_PORT, &hints, &servinfo) != 0) {
+            log("getaddrinfo fail");
             return std::nullopt;
         }
 
         // 创建socket
         int sockfd = socket(servinfo->ai_family, servinfo->ai_socktype, servinfo->ai_protocol);
         if (sockfd < 0) {
-            if (verbose_) {
-                std::cerr << "socket create failed: " << strerror(errno) << std::endl;
-            }
+            log("socket create failed: %s", strerror(errno));
             freeaddrinfo(servinfo);
             return std::nullopt;
         }
 
+#ifdef SO_NOSIGPIPE
         // Prevent SIGPIPE signals
         //防止终止进程的信号？
         int nosigpipe = 1;
         //SO_NOSIGPIPE是为了避免网络错误，而导致进程退出。用这个来避免系统发送signal
         setsockopt(sockfd, SOL_SOCKET, SO_NOSIGPIPE, &nosigpipe, sizeof(nosigpipe));
+#endif
 
         // 设置超时
         struct timeval tv;
         tv.tv_sec = timeout_sec_;
         tv.tv_usec = 0;
         if (setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv)) < 0) {
-            if (verbose_) {
-                std::cerr << "set receive timeout failed: " << strerror(errno) << std::endl;
-            }
+            log("set receive timeout failed: %s", strerror(errno));
             close(sockfd);
             freeaddrinfo(servinfo);
             return std::nullopt;
@@ -223,7 +535,7 @@ class SntpClient::Implement {
         sntp_request.lvm.mode = NTP_MODE_CLIENT;
 
         // 记录发送时间 (t1)
-        double requestTime = system_clock_->currentTimeMillis() / 1000.0;
+        double requestTime = system_clock_.currentTimeMillis() / 1000.0;
         uint32_t ntp_seconds = (uint32_t)(requestTime + NTP_TIMESTAMP_DELTA);
         uint32_t ntp_fraction = (uint32_t)((requestTime - (int)requestTime) * (1LL << 32));
 
@@ -235,43 +547,75 @@ class SntpClient::Implement {
             printSntpPacket("SNTP Request", sntp_request, true);
         }
 
+        // 连接后内核只接收来自该服务器地址的响应
+        if (connect(sockfd, servinfo->ai_addr, servinfo->ai_addrlen) < 0) {
+            log("connect failed: %s", strerror(errno));
+            close(sockfd);
+            freeaddrinfo(servinfo);
+            return std::nullopt;
+        }
+
         // 发送请求
-        if (sendto(sockfd, &sntp_request, sizeof(struct sntp_packet), 0, servinfo->ai_addr, servinfo->ai_addrlen) < 0) {
-            if (verbose_) {
-                std::cerr << "send request failed: " << strerror(errno) << std::endl;
-            }
+        if (send(sockfd, &sntp_request, sizeof(struct sntp_packet), 0) < 0) {
+            log("send request failed: %s", strerror(errno));
             close(sockfd);
             freeaddrinfo(servinfo);
             return std::nullopt;
         }
 
         // 接收响应
-        if (recvfrom(sockfd, &sntp_reply, sizeof(struct sntp_packet), 0, nullptr, nullptr) < 0) {
-            if (verbose_) {
-                std::cerr << "receive response failed: " << strerror(errno)
-                          << " (timeout=" << timeout_sec_ << "s)" << std::endl;
-            }
+        if (recv(sockfd, &sntp_reply, sizeof(struct sntp_packet), 0) < 0) {
+            log("receive response failed: %s (timeout=%ds)", strerror(errno), timeout_sec_);
             close(sockfd);
             freeaddrinfo(servinfo);
             return std::nullopt;
         }
 
+        // 记录接收时间 (t4)
+        SntpExchange exchange;
+        exchange.receive_wall_ms = system_clock_.currentTimeMillis();
+        exchange.receive_elapsed_ms = system_clock_.elapsedRealtime();
+        exchange.receive_uptime_ms = system_clock_.uptimeMillis();
+        exchange.request = sntp_request;
+        exchange.reply = sntp_reply;
+
+        // 作为上游标识，IPv4 为地址本身，IPv6 取地址 MD5 摘要的前4字节 (RFC 5905 7.3)
+        exchange.ref_id = 0;
+        if (servinfo->ai_family == AF_INET) {
+            exchange.ref_id = reinterpret_cast<sockaddr_in *>(servinfo->ai_addr)->sin_addr.s_addr;
+        } else if (servinfo->ai_family == AF_INET6) {
+            uint8_t digest[16];
+            const in6_addr &address = reinterpret_cast<sockaddr_in6 *>(servinfo->ai_addr)->sin6_addr;
+            md5(&address, sizeof(address), digest);
+            memcpy(&exchange.ref_id, digest, sizeof(exchange.ref_id));
+        }
+
         close(sockfd);
         freeaddrinfo(servinfo);
 
+        if (capture_.isOpen() && !capture_.write(server, exchange)) {
+            log("write capture file failed");
+        }
+
+        return evaluateExchange(exchange, status);
+    }
+
+    /// 校验响应并计算偏移，不访问网络，回放抓包时直接调用
+    std::optional<TimeResult> evaluateExchange(const SntpExchange &exchange, SyncStatus &status) const {
+        sntp_packet sntp_reply = exchange.reply;
+
         if (verbose_) {
             printSntpPacket("SNTP Response", sntp_reply, true);
         }
 
+        status = SyncStatus::Invalid;
+
         if (sntp_reply.lvm.mode != NTP_MODE_SERVER) {
-            if (verbose_) {
-                std::cerr << "received packet is invalid" << std::endl;
-            }
+            log("received packet is invalid");
             return std::nullopt;
         }
 
-        // 记录接收时间 (t4)
-        double t4 = system_clock_->currentTimeMillis() / 1000.0;
+        double t4 = exchange.receive_wall_ms / 1000.0;
 
         sntp_reply.ref_time.seconds = ntohl(sntp_reply.ref_time.seconds);
         sntp_reply.ref_time.fraction = ntohl(sntp_reply.ref_time.fraction);
@@ -282,8 +626,20 @@ class SntpClient::Implement {
         sntp_reply.tran_time.seconds = ntohl(sntp_reply.tran_time.seconds);
         sntp_reply.tran_time.fraction = ntohl(sntp_reply.tran_time.fraction);
 
+        // 源时间戳与本次请求不符的响应可能是伪造的，KoD 也必须先通过该校验 (RFC 5905 7.4)
+        ntp_timestamp request_timestamp = {ntohl(exchange.request.tran_time.seconds), ntohl(exchange.request.tran_time.fraction)};
+        if (!checkOriginTimestamp(request_timestamp, sntp_reply.ori_time)) {
+            return std::nullopt;
+        }
+
+        // KoD 的 LI 按规范为 3（未同步），因此在 LI 校验之前处理
         int stratum = sntp_reply.stratum & 0xff;
-        if (checkValidServerReply(sntp_reply.lvm.li, sntp_reply.lvm.mode, stratum, sntp_reply.tran_time, sntp_reply.ref_time, sntp_request.tran_time, sntp_reply.ori_time)) {
+        if (stratum == NTP_STRATUM_DEATH) {
+            status = checkKissCode(sntp_reply.ref_id);
+            return std::nullopt;
+        }
+
+        if (!checkValidServerReply(sntp_reply.lvm.li, sntp_reply.lvm.mode, stratum, sntp_reply.tran_time, sntp_reply.ref_time, request_timestamp, sntp_reply.ori_time)) {
             return std::nullopt;
         }
 
@@ -292,71 +648,93 @@ class SntpClient::Implement {
         double t2 = (sntp_reply.recv_time.seconds - NTP_TIMESTAMP_DELTA) + (double)sntp_reply.recv_time.fraction / (1LL << 32);
         double t3 = (sntp_reply.tran_time.seconds - NTP_TIMESTAMP_DELTA) + (double)sntp_reply.tran_time.fraction / (1LL << 32);
 
-        TimeResult result = {0, 0, 0};
+        TimeResult result{};
 
         // 计算往返延迟和偏移
         result.delay = (t4 - t1) - (t3 - t2);
         result.offset = ((t2 - t1) + (t3 - t4)) / 2;
 
-        result.sync_boot_time = system_clock_->elapsedRealtime();
+        // 上游的根延迟/根离散度 (NTP short format 16.16)
+        double upstream_root_delay = (int16_t)ntohs(sntp_reply.root_delay_int) + ntohs(sntp_reply.root_delay_fraction) / 65536.0;
+        double upstream_root_dispersion = (int16_t)ntohs(sntp_reply.root_dispersion_int) + ntohs(sntp_reply.root_dispersion_fraction) / 65536.0;
+        result.stratum = stratum;
+        result.ref_id = exchange.ref_id;
+        result.root_delay = upstream_root_delay + std::max(result.delay, 0.0);
+        // 上游离散度 + 双方时钟精度 + 往返期间的频率误差
+        result.root_dispersion = upstream_root_dispersion + ldexp(1.0, sntp_reply.precision) + ldexp(1.0, LOCAL_CLOCK_PRECISION) + NTP_PHI * std::max(result.delay, 0.0);
+
+        result.sync_boot_time = exchange.receive_elapsed_ms;
+        result.sync_uptime = exchange.receive_uptime_ms;
+        result.sync_wall_time = exchange.receive_wall_ms;
         // 计算同步时的服务器时间
         result.sync_time = t4 + result.offset;
 
+        status = SyncStatus::Success;
+
         if (verbose_) {
-            std::cerr << "本地发送时间(t1)=" << getFormattedTime(t1)
-                      << ", 服务器接收时间(t2)=" << getFormattedTime(t2)
-                      << ", 服务器发送时间(t3)=" << getFormattedTime(t3)
-                      << ", 本地接收时间(t4)=" << getFormattedTime(t4)
-                      << std::fixed << std::setprecision(2)
-                      << ", 延迟=" << result.delay * 1000.0 << "ms"
-                      << ", 偏移=" << result.offset * 1000.0 << "ms"
-                      << ", 同步时服务器时间=" << getFormattedTime(result.sync_time)
-                      << std::endl;
+            char t1_text[32], t2_text[32], t3_text[32], t4_text[32], sync_text[32];
+            formatTime(t1, t1_text, sizeof(t1_text));
+            formatTime(t2, t2_text, sizeof(t2_text));
+            formatTime(t3, t3_text, sizeof(t3_text));
+            formatTime(t4, t4_text, sizeof(t4_text));
+            formatTime(result.sync_time, sync_text, sizeof(sync_text));
+            log("本地发送时间(t1)=%s, 服务器接收时间(t2)=%s, 服务器发送时间(t3)=%s, 本地接收时间(t4)=%s, 延迟=%.2fms, 偏移=%.2fms, 同步时服务器时间=%s",
+                t1_text, t2_text, t3_text, t4_text, result.delay * 1000.0, result.offset * 1000.0, sync_text);
         }
 
         return result;
     }
 
-    bool checkValidServerReply(int leap, int mode, int stratum, const ntp_timestamp &transmitTimestamp, const ntp_timestamp &referenceTimestamp, const ntp_timestamp &requestTimestamp, const ntp_timestamp &originateTimestamp) {
+    /// stratum 为 0 时 ref_id 为 Kiss-o'-Death 代码 (RFC 5905 7.4)
+    SyncStatus checkKissCode(const uint8_t ref_id[4]) const {
+        char code[5] = {0};
+        memcpy(code, ref_id, 4);
+        log("kiss-o'-death: %s", code);
+
+        if (strcmp(code, "RATE") == 0) {
+            return SyncStatus::KissRate;
+        }
+        if (strcmp(code, "DENY") == 0 || strcmp(code, "RSTR") == 0) {
+            return SyncStatus::KissDeny;
+        }
+        return SyncStatus::Invalid;
+    }
+
+    bool checkOriginTimestamp(const ntp_timestamp &requestTimestamp, const ntp_timestamp &originateTimestamp) const {
+        if (requestTimestamp.seconds != originateTimestamp.seconds || requestTimestamp.fraction != originateTimestamp.fraction) {
+            log("originateTimestamp != randomizedRequestTimestamp");
+            return false;
+        }
+        return true;
+    }
+
+    bool checkValidServerReply(int leap, int mode, int stratum, const ntp_timestamp &transmitTimestamp, const ntp_timestamp &referenceTimestamp, const ntp_timestamp &requestTimestamp, const ntp_timestamp &originateTimestamp) const {
         if (leap == NTP_LEAP_NOSYNC) {
-            if (verbose_) {
-                std::cerr << "unsynchronized server" << std::endl;
-            }
+            log("unsynchronized server");
             return false;
         }
 
         if ((mode != NTP_MODE_SERVER) && (mode != NTP_MODE_BROADCAST)) {
-            if (verbose_) {
-                std::cerr << "untrusted mode: " << mode << std::endl;
-            }
+            log("untrusted mode: %d", mode);
             return false;
         }
 
         if ((stratum == NTP_STRATUM_DEATH) || (stratum > NTP_STRATUM_MAX)) {
-            if (verbose_) {
-                std::cerr << "untrusted stratum: " << stratum << std::endl;
-            }
+            log("untrusted stratum: %d", stratum);
             return false;
         }
 
-        if (requestTimestamp.seconds != originateTimestamp.seconds || requestTimestamp.fraction != originateTimestamp.fraction) {
-            if (verbose_) {
-                std::cerr << "originateTimestamp != randomizedRequestTimestamp" << std::endl;
-            }
+        if (!checkOriginTimestamp(requestTimestamp, originateTimestamp)) {
             return false;
         }
 
         if (transmitTimestamp.seconds == 0 && transmitTimestamp.fraction == 0) {
-            if (verbose_) {
-                std::cerr << "zero transmitTimestamp" << std::endl;
-            }
+            log("zero transmitTimestamp");
             return false;
         }
 
         if (referenceTimestamp.seconds == 0 && referenceTimestamp.fraction == 0) {
-            if (verbose_) {
-                std::cerr << "zero referenceTimestamp" << std::endl;
-            }
+            log("zero referenceTimestamp");
             return false;
         }
 
@@ -364,56 +742,127 @@ class SntpClient::Implement {
     }
 
     double getServerTime() const {
+        std::lock_guard<std::mutex> lock(mutex_);
         if (!is_synced_) {
             return 0;
         }
-        uint64_t now = system_clock_->elapsedRealtime();
+        uint64_t now = system_clock_.elapsedRealtime();
         double elapsed = (now - base_boottime_) / 1000.0;
         return base_server_time_ + elapsed;
     }
 
+    SntpSyncState getSyncState() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        SntpSyncState state;
+        if (!is_synced_) {
+            return state;
+        }
+        uint64_t now = system_clock_.elapsedRealtime();
+        double elapsed = (now - base_boottime_) / 1000.0;
+        state.synced = true;
+        state.server_time = base_server_time_ + elapsed;
+        state.sync_server_time = base_server_time_;
+        state.time_since_sync = elapsed;
+        state.stratum = base_stratum_;
+        state.root_delay = base_root_delay_;
+        state.root_dispersion = base_root_dispersion_ + NTP_PHI * elapsed;
+        state.ref_id = base_ref_id_;
+        return state;
+    }
+
     std::string getFormattedServerTime() const {
-        time_t server_time = static_cast<time_t>(getServerTime());
-        struct tm *timeinfo = localtime(&server_time);
         char buffer[80];
-        strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
+        getFormattedServerTime(buffer, sizeof(buffer));
         return std::string(buffer);
     }
 
-    std::string getFormattedTime(time_t t) const {
-        time_t time = static_cast<time_t>(t);
-        struct tm *timeinfo = localtime(&time);
-        char buffer[80];
-        strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
-        return std::string(buffer);
+    size_t getFormattedServerTime(char *buffer, size_t size) const {
+        return formatTime(static_cast<time_t>(getServerTime()), buffer, size);
+    }
+
+    static size_t formatTime(time_t t, char *buffer, size_t size) {
+        struct tm timeinfo;
+        localtime_r(&t, &timeinfo);
+        return strftime(buffer, size, "%Y-%m-%d %H:%M:%S", &timeinfo);
     }
 
     bool isSynced() const {
+        std::lock_guard<std::mutex> lock(mutex_);
         return is_synced_;
     }
 
     double getTimeSinceLastSync() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return timeSinceLastSyncLocked();
+    }
+
+    double timeSinceLastSyncLocked() const {
         if (!is_synced_) {
             return 0;
         }
-        uint64_t now = system_clock_->elapsedRealtime();
+        uint64_t now = system_clock_.elapsedRealtime();
         return (now - base_boottime_) / 1000.0;
     }
 
     bool needResync(double max_interval) const {
-        return !is_synced_ || getTimeSinceLastSync() > max_interval;
+        std::lock_guard<std::mutex> lock(mutex_);
+        return !is_synced_ || timeSinceLastSyncLocked() > max_interval || clockDisturbedLocked();
+    }
+
+    /// 同步后是否发生过休眠/虚拟机暂停或本机时间跳变
+    /// 服务器时间基于包含休眠的启动时间推算，但休眠期间由 RTC 计时误差较大，虚拟机暂停也可能不计入启动时间，需要立即重新同步
+    bool clockDisturbedLocked() const {
+        int64_t elapsed = (int64_t)(system_clock_.elapsedRealtime() - base_boottime_);
+        int64_t uptime = (int64_t)(system_clock_.uptimeMillis() - base_uptime_);
+        int64_t wall = (int64_t)system_clock_.currentTimeMillis() - (int64_t)base_wall_time_;
+
+        int64_t suspended = elapsed - uptime;
+        if (suspended > SUSPEND_RESYNC_THRESHOLD_MS) {
+            log("suspend detected since last sync: %lldms", (long long)suspended);
+            return true;
+        }
+
+        int64_t step = wall - elapsed;
+        if (std::llabs(step) > CLOCK_STEP_RESYNC_THRESHOLD_MS + (int64_t)(elapsed * CLOCK_SLEW_MAX)) {
+            log("wall clock step detected since last sync: %lldms", (long long)step);
+            return true;
+        }
+        return false;
     }
 };
 
+#if SNTP_CLIENT_MINIMAL
+SntpClient::SntpClient()
+    : impl_(new (impl_storage_) Implement()) {
+    static_assert(sizeof(Implement) <= SNTP_CLIENT_IMPL_SIZE, "increase SNTP_CLIENT_IMPL_SIZE");
+    static_assert(alignof(Implement) <= alignof(std::max_align_t), "Implement is over-aligned");
+}
+
+SntpClient::~SntpClient() {
+    impl_->~Implement();
+}
+#else
 SntpClient::SntpClient()
     : impl_(std::make_unique<Implement>()) {
 }
 
 SntpClient::~SntpClient() {
 }
+#endif
+
+static_assert(SntpClient::MAX_SERVERS == SERVER_POOL_CAPACITY, "MAX_SERVERS must match the server pool");
+static_assert(SntpClient::MAX_SERVER_NAME_LENGTH == SERVER_NAME_MAX - 1, "MAX_SERVER_NAME_LENGTH must match the server pool");
+
+bool SntpClient::setServer(const std::string &server) {
+    return impl_->setServer(server);
+}
+
+bool SntpClient::addServer(const std::string &server) {
+    return impl_->addServer(server);
+}
 
-void SntpClient::setServer(const std::string &server) {
-    impl_->setServer(server);
+void SntpClient::setMaxAttempts(int attempts) {
+    impl_->setMaxAttempts(attempts);
 }
 
 void SntpClient::setTimeout(int seconds) {
@@ -424,6 +873,26 @@ void SntpClient::setVerbose(bool verbose) {
     impl_->setVerbose(verbose);
 }
 
+bool SntpClient::setCaptureFile(const std::string &path) {
+    return impl_->setCaptureFile(path);
+}
+
+long SntpClient::replayCapture(const std::string &path, ReplayHandler handler, void *context) {
+    return impl_->replayCapture(path, handler, context);
+}
+
+void SntpClient::setLogHandler(LogHandler handler, void *context) {
+    impl_->setLogHandler(handler, context);
+}
+
+void SntpClient::setServerClockSource(bool enable) {
+    impl_->setServerClockSource(enable);
+}
+
+void SntpClient::setSharedSync(bool shared) {
+    impl_->setSharedSync(shared);
+}
+
 bool SntpClient::sync() {
     return impl_->sync();
 }
@@ -436,6 +905,14 @@ std::string SntpClient::getFormattedServerTime() const {
     return impl_->getFormattedServerTime();
 }
 
+size_t SntpClient::getFormattedServerTime(char *buffer, size_t size) const {
+    return impl_->getFormattedServerTime(buffer, size);
+}
+
+SntpSyncState SntpClient::getSyncState() const {
+    return impl_->getSyncState();
+}
+
 bool SntpClient::isSynced() const {
     return impl_->isSynced();
 }
@@ -8,22 +8,116 @@
 #ifndef sntp_client_hpp
 #define sntp_client_hpp
 
+#include <cstddef>
+#include <cstdint>
 #include <memory>
-#include <optional>
 #include <string>
 
+// SNTP_CLIENT_MINIMAL 决定 SntpClient 的布局，由构建时生成的配置头文件固定，不能由使用方另行定义
+#include "sntp_client_config.h"
+
 namespace time_sync {
 
+/// 同步状态快照
+struct SntpSyncState {
+    /// 是否已同步
+    bool synced{false};
+    /// 快照时刻的服务器时间（秒）
+    double server_time{0};
+    /// 同步时的服务器时间（秒）
+    double sync_server_time{0};
+    /// 距上次同步的时间（秒）
+    double time_since_sync{0};
+    /// 上游服务器层级
+    int stratum{0};
+    /// 到主参考源的根延迟（秒），含本机与上游的往返延迟
+    double root_delay{0};
+    /// 到主参考源的根离散度（秒），随距上次同步的时间增长
+    double root_dispersion{0};
+    /// 上游服务器标识（网络字节序），IPv4 为地址本身，IPv6 为地址 MD5 摘要的前4字节
+    uint32_t ref_id{0};
+};
+
+/// 抓包回放中单条记录的校验结果
+enum class SntpReplayStatus {
+    /// 通过校验
+    Success,
+    /// 未通过校验
+    Invalid,
+    /// Kiss-o'-Death RATE，请求过于频繁
+    KissRate,
+    /// Kiss-o'-Death DENY/RSTR，拒绝服务
+    KissDeny,
+};
+
+/// 抓包回放中单条记录的计算结果
+struct SntpReplayRecord {
+    /// 服务器地址
+    const char *server{nullptr};
+    /// 是否通过校验，未通过时以下计算结果无效
+    bool valid{false};
+    /// 校验结果，可区分 KoD 与其他校验失败
+    SntpReplayStatus status{SntpReplayStatus::Invalid};
+    /// status 为 KissRate/KissDeny 时的 Kiss-o'-Death 代码（RATE/DENY/RSTR），其他情况为空字符串
+    char kiss_code[5]{};
+    /// 时间偏移（秒）
+    double offset{0};
+    /// 往返延迟（秒）
+    double delay{0};
+    /// 上游服务器层级
+    int stratum{0};
+    /// 到主参考源的根延迟（秒）
+    double root_delay{0};
+    /// 到主参考源的根离散度（秒）
+    double root_dispersion{0};
+    /// 收到响应时的服务器时间（秒）
+    double server_time{0};
+    /// 记录时收到响应的启动时间（毫秒）
+    uint64_t receive_elapsed_ms{0};
+};
+
 class SntpClient {
   public:
+    /// 日志回调
+    /// - Parameters:
+    ///   - message: 单行日志，不含换行
+    ///   - context: setLogHandler 传入的 context
+    using LogHandler = void (*)(const char *message, void *context);
+
+    /// 抓包回放回调
+    /// - Parameters:
+    ///   - record: 单条记录的计算结果，回调返回后失效
+    ///   - context: replayCapture 传入的 context
+    using ReplayHandler = void (*)(const SntpReplayRecord &record, void *context);
+
     /// 创建SntpClient
     explicit SntpClient();
 
     ~SntpClient();
 
-    /// 配置NTP服务
+    /// 最多配置的服务器数
+    static constexpr int MAX_SERVERS = 8;
+    /// 服务器地址最大长度（字符）
+    static constexpr size_t MAX_SERVER_NAME_LENGTH = 255;
+
+    SntpClient(const SntpClient &) = delete;
+    SntpClient &operator=(const SntpClient &) = delete;
+
+    /// 配置NTP服务，替换已配置的所有服务器
     /// - Parameter server: 例如 time.apple.com time.windows.com ntp.aliyun.com ntp.tencent.com
-    void setServer(const std::string &server);
+    /// - Returns: 地址超过 MAX_SERVER_NAME_LENGTH 时返回 false，此时不再有可用服务器
+    bool setServer(const std::string &server);
+
+    /// 添加NTP服务器
+    /// 每次同步按可达性、延迟、抖动和校验失败次数选择得分最高的服务器；
+    /// 收到 KoD RATE 的服务器会退避一段时间，收到 DENY/RSTR 的服务器不再使用，重新添加可恢复
+    /// - Parameter server: 服务器地址
+    /// - Returns: 已有 MAX_SERVERS 个服务器或地址超过 MAX_SERVER_NAME_LENGTH 时返回 false，服务器未添加
+    bool addServer(const std::string &server);
+
+    /// 设置单次同步最多尝试的服务器数
+    /// - Parameter attempts: 默认 3
+    void setMaxAttempts(int attempts);
 
     /// 设置超时时间
     /// - Parameter seconds: 超时时间，默认1s
@@ -32,14 +126,50 @@ class SntpClient {
     /// 启用详细信息输出
     /// - Parameter verbose:
     void setVerbose(bool verbose);
+
+    /// 设置日志回调，启用详细信息输出时调用，未设置时输出到 stderr
+    /// - Parameters:
+    ///   - handler: 回调，传 nullptr 恢复默认
+    ///   - context: 原样传给回调
+    void setLogHandler(LogHandler handler, void *context = nullptr);
     
-    /// 执行同步
+    /// 跨客户端合并同步
+    /// 同一客户端的并发 sync() 总是合并为一次网络请求；启用后进程内配置了相同服务器的客户端也共享同一次请求
+    /// 精简模式下不支持
+    /// - Parameter shared: 默认 false
+    void setSharedSync(bool shared);
+
+    /// 作为 time_sync::server_clock 的时间来源
+    /// 启用后每次同步成功都会更新进程级的 server_clock；多个客户端启用时以最近一次同步为准
+    /// - Parameter enable: 默认 false
+    void setServerClockSource(bool enable);
+
+    /// 执行同步，可在多个线程并发调用，并发的调用共享同一次网络请求的结果
     bool sync();
 
     /// 获取同步后当前服务器时间（秒）
     double getServerTime() const;
     /// 获取格式化的服务器时间
     std::string getFormattedServerTime() const;
+    /// 获取格式化的服务器时间，写入调用方提供的缓冲区
+    /// - Returns: 写入的字符数，不含结尾的0，缓冲区不足时返回0
+    size_t getFormattedServerTime(char *buffer, size_t size) const;
+
+    /// 记录每次收到的请求/响应原始报文与本地时间到二进制抓包文件，用于离线回放
+    /// - Parameter path: 以追加方式打开；传空字符串停止记录
+    /// - Returns: 文件无法打开时返回 false
+    bool setCaptureFile(const std::string &path);
+
+    /// 离线回放抓包文件，逐条执行与 sync() 相同的响应校验与偏移计算，不访问网络，也不修改同步状态
+    /// - Parameters:
+    ///   - path: setCaptureFile 记录的文件
+    ///   - handler: 每条记录的结果回调
+    ///   - context: 原样传给回调
+    /// - Returns: 回放的记录数；文件无法读取、文件头不符或遇到截断/损坏的记录时返回 -1，损坏处之前的记录已回调
+    long replayCapture(const std::string &path, ReplayHandler handler, void *context = nullptr);
+
+    /// 获取同步状态快照，可在其他线程调用
+    SntpSyncState getSyncState() const;
 
     /// 是否已同步
     bool isSynced() const;
@@ -53,7 +183,12 @@ class SntpClient {
 
   private:
     class Implement;
+#if SNTP_CLIENT_MINIMAL
+    alignas(std::max_align_t) unsigned char impl_storage_[SNTP_CLIENT_IMPL_SIZE];
+    Implement *impl_;
+#else
     std::unique_ptr<Implement> impl_;
+#endif
 };
 };  // namespace time_sync
 
@@ -0,0 +1,40 @@
+//
+//  sntp_constants.hpp
+//  sntp_client
+//
+//  Created by king on 2024/11/17.
+//
+
+#ifndef sntp_constants_hpp
+#define sntp_constants_hpp
+
+#include <cstddef>
+#include <cstdint>
+
+namespace time_sync {
+// NTP时间从1900年开始,需要和Unix时间(1970年开始)转换
+constexpr uint64_t NTP_TIMESTAMP_DELTA = 2208988800ull;
+
+constexpr int NTP_PACKET_SIZE = 48;
+
+constexpr char STANDARD_NTP_PORT[] = "123";
+constexpr int NTP_MODE_CLIENT = 3;
+constexpr int NTP_MODE_SERVER = 4;
+constexpr int NTP_MODE_BROADCAST = 4;
+constexpr int NTP_VERSION = 3;
+
+constexpr int NTP_LEAP_NOSYNC = 3;
+constexpr int NTP_STRATUM_DEATH = 0;
+constexpr int NTP_STRATUM_MAX = 15;
+
+// 本地时钟精度 log2(秒)，elapsedRealtime 以毫秒为单位，约 2^-10 秒
+constexpr int LOCAL_CLOCK_PRECISION = -10;
+
+// 频率容差 15ppm，用于计算离散度随时间的增长 (RFC 5905 PHI)
+constexpr double NTP_PHI = 15e-6;
+
+// 单条日志最大长度
+constexpr size_t LOG_MESSAGE_MAX = 512;
+};  // namespace time_sync
+
+#endif /* sntp_constants_hpp */
@@ -0,0 +1,530 @@
+//
+//  sntp_server.cpp
+//  sntp_client
+//
+//  Created by king on 2024/11/17.
+//
+
+#include "sntp_server.hpp"
+
+#include "sntp_client.hpp"
+#include "sntp_constants.hpp"
+#include "sntp_types.h"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+
+#include <vector>
+
+namespace time_sync {
+
+// 单次 recvmmsg/sendmmsg 处理的最大包数
+constexpr int SERVER_BATCH_SIZE = 64;
+// 接收缓冲区大小，请求可能携带扩展字段或MAC
+constexpr int SERVER_RECV_BUFFER_SIZE = 512;
+// 接收超时（毫秒），用于定期检查停止标志
+constexpr int SERVER_RECV_TIMEOUT_MS = 200;
+
+// 未同步时回复的 Kiss code
+constexpr char NTP_KISS_INIT[] = "INIT";
+
+/// 同一批请求共用的时间基准
+struct ServerTimeBase {
+    SntpSyncState state;
+    /// 取快照时的本机时间 CLOCK_REALTIME，与内核接收时间戳同源
+    struct timespec wall;
+    /// wall 时刻对应的服务器时间（秒），未同步时为本机时间
+    double server_time;
+};
+
+struct alignas(64) ServerWorker {
+    int sockfd{-1};
+    bool owns_socket{false};
+    std::thread thread;
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> responses{0};
+    std::atomic<uint64_t> dropped{0};
+};
+
+static double diffSeconds(const struct timespec &a, const struct timespec &b) {
+    return (a.tv_sec - b.tv_sec) + (a.tv_nsec - b.tv_nsec) / 1e9;
+}
+
+static ntp_timestamp toNtpTimestamp(double unix_time) {
+    double ntp_time = unix_time + NTP_TIMESTAMP_DELTA;
+    double seconds = floor(ntp_time);
+    double fraction = std::min((ntp_time - seconds) * (1LL << 32), 4294967295.0);
+    ntp_timestamp ts;
+    ts.seconds = htonl((uint32_t)seconds);
+    ts.fraction = htonl((uint32_t)fraction);
+    return ts;
+}
+
+static void toNtpShort(double value, int16_t &integer, uint16_t &fraction) {
+    value = std::clamp(value, 0.0, 32767.0);
+    double seconds = floor(value);
+    integer = (int16_t)htons((uint16_t)seconds);
+    fraction = htons((uint16_t)((value - seconds) * 65536.0));
+}
+
+static bool kernelReceiveTime(struct msghdr &msg, struct timespec &ts) {
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+#ifdef SCM_TIMESTAMPNS
+        if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            return true;
+        }
+#endif
+#ifdef SCM_TIMESTAMP
+        if (cmsg->cmsg_type == SCM_TIMESTAMP) {
+            struct timeval tv;
+            memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+            ts.tv_sec = tv.tv_sec;
+            ts.tv_nsec = tv.tv_usec * 1000;
+            return true;
+        }
+#endif
+    }
+    return false;
+}
+
+class SntpServer::Implement {
+  public:
+    const SntpClient &client_;
+    uint16_t port_{123};
+    int threads_{0};
+    bool verbose_{false};
+    SntpServer::LogHandler log_handler_{nullptr};
+    void *log_context_{nullptr};
+    std::atomic<bool> running_{false};
+    std::vector<std::unique_ptr<ServerWorker>> workers_;
+
+    explicit Implement(const SntpClient &client)
+        : client_(client) {}
+
+    ~Implement() {
+        stop();
+    }
+
+    void setPort(uint16_t port) {
+        port_ = port;
+    }
+
+    void setThreads(int threads) {
+        threads_ = threads;
+    }
+
+    void setVerbose(bool verbose) {
+        verbose_ = verbose;
+    }
+
+    void setLogHandler(SntpServer::LogHandler handler, void *context) {
+        log_handler_ = handler;
+        log_context_ = context;
+    }
+
+#if defined(__GNUC__) || defined(__clang__)
+    __attribute__((format(printf, 2, 3)))
+#endif
+    void log(const char *format, ...) const {
+        if (!verbose_) {
+            return;
+        }
+
+        char message[LOG_MESSAGE_MAX];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(message, sizeof(message), format, args);
+        va_end(args);
+
+        if (log_handler_ != nullptr) {
+            log_handler_(message, log_context_);
+        } else {
+            fprintf(stderr, "%s\n", message);
+        }
+    }
+
+    bool start() {
+        if (running_) {
+            return false;
+        }
+
+        // 统计数据保留到下次启动
+        workers_.clear();
+        int count = threads_ > 0 ? threads_ : std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i < count; i++) {
+            auto worker = std::make_unique<ServerWorker>();
+#if defined(__linux__)
+            // 每个线程独立socket，由内核按四元组哈希分发
+            worker->sockfd = openSocket();
+            worker->owns_socket = true;
+#else
+            // 其他平台 SO_REUSEPORT 不做负载均衡，所有线程共享一个socket
+            worker->sockfd = i == 0 ? openSocket() : workers_[0]->sockfd;
+            worker->owns_socket = i == 0;
+#endif
+            workers_.push_back(std::move(worker));
+            if (workers_.back()->sockfd < 0) {
+                closeSockets();
+                return false;
+            }
+        }
+
+        running_ = true;
+        for (auto &worker : workers_) {
+            ServerWorker *w = worker.get();
+            w->thread = std::thread([this, w] {
+#if defined(__linux__)
+                runBatched(*w);
+#else
+                runSimple(*w);
+#endif
+            });
+        }
+
+        log("sntp server listening on port %u with %d threads", (unsigned)port_, count);
+        return true;
+    }
+
+    void stop() {
+        running_ = false;
+        for (auto &worker : workers_) {
+            if (worker->thread.joinable()) {
+                worker->thread.join();
+            }
+        }
+        closeSockets();
+    }
+
+    void closeSockets() {
+        for (auto &worker : workers_) {
+            if (worker->owns_socket && worker->sockfd >= 0) {
+                close(worker->sockfd);
+            }
+            worker->sockfd = -1;
+        }
+    }
+
+    bool isRunning() const {
+        return running_;
+    }
+
+    uint64_t sumCounter(std::atomic<uint64_t> ServerWorker::*counter) const {
+        uint64_t total = 0;
+        for (auto &worker : workers_) {
+            total += ((*worker).*counter).load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    int openSocket() {
+        // 优先使用双栈socket，同时服务 IPv4 与 IPv6
+        int sockfd = socket(AF_INET6, SOCK_DGRAM, 0);
+        bool ipv6 = sockfd >= 0;
+        if (!ipv6) {
+            sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+        }
+        if (sockfd < 0) {
+            log("socket create failed: %s", strerror(errno));
+            return -1;
+        }
+
+        int on = 1;
+        int off = 0;
+#ifdef SO_REUSEPORT
+        setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+#endif
+        if (ipv6) {
+            setsockopt(sockfd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+        }
+
+        // 由内核记录接收时间戳，避免排队时间计入服务器接收时间(t2)
+#if defined(SO_TIMESTAMPNS)
+        setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+#elif defined(SO_TIMESTAMP)
+        setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMP, &on, sizeof(on));
+#endif
+
+        struct timeval tv;
+        tv.tv_sec = 0;
+        tv.tv_usec = SERVER_RECV_TIMEOUT_MS * 1000;
+        setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        int ret = 0;
+        if (ipv6) {
+            struct sockaddr_in6 addr = {};
+            addr.sin6_family = AF_INET6;
+            addr.sin6_addr = in6addr_any;
+            addr.sin6_port = htons(port_);
+            ret = bind(sockfd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+        } else {
+            struct sockaddr_in addr = {};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_ANY);
+            addr.sin_port = htons(port_);
+            ret = bind(sockfd, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr));
+        }
+        if (ret < 0) {
+            log("bind port %u failed: %s", (unsigned)port_, strerror(errno));
+            close(sockfd);
+            return -1;
+        }
+        return sockfd;
+    }
+
+    ServerTimeBase takeTimeBase() const {
+        ServerTimeBase base;
+        base.state = client_.getSyncState();
+        clock_gettime(CLOCK_REALTIME, &base.wall);
+        base.server_time = base.state.synced ? base.state.server_time : base.wall.tv_sec + base.wall.tv_nsec / 1e9;
+        return base;
+    }
+
+    static double serverTimeAt(const ServerTimeBase &base, const struct timespec &wall) {
+        return base.server_time + diffSeconds(wall, base.wall);
+    }
+
+    /// 根据请求填充响应，接收/发送时间戳由调用方填写
+    static bool buildReply(const uint8_t *data, size_t size, const ServerTimeBase &base, sntp_packet &reply) {
+        if (size < NTP_PACKET_SIZE) {
+            return false;
+        }
+
+        sntp_packet request;
+        memcpy(&request, data, sizeof(request));
+        if (request.lvm.mode != NTP_MODE_CLIENT || request.lvm.vn < 1 || request.lvm.vn > 4) {
+            return false;
+        }
+
+        const SntpSyncState &state = base.state;
+        int stratum = state.stratum + 1;
+        bool synced = state.synced && stratum <= NTP_STRATUM_MAX;
+
+        memset(&reply, 0, sizeof(reply));
+        reply.lvm.li = synced ? 0 : NTP_LEAP_NOSYNC;
+        reply.lvm.vn = request.lvm.vn;
+        reply.lvm.mode = NTP_MODE_SERVER;
+        reply.poll = request.poll;
+        reply.precision = LOCAL_CLOCK_PRECISION;
+        // 原样回填客户端发送时间戳，保持网络字节序
+        reply.ori_time = request.tran_time;
+
+        if (synced) {
+            reply.stratum = stratum;
+            toNtpShort(state.root_delay, reply.root_delay_int, reply.root_delay_fraction);
+            toNtpShort(state.root_dispersion, reply.root_dispersion_int, reply.root_dispersion_fraction);
+            memcpy(reply.ref_id, &state.ref_id, sizeof(reply.ref_id));
+            reply.ref_time = toNtpTimestamp(state.sync_server_time);
+        } else {
+            reply.stratum = NTP_STRATUM_DEATH;
+            memcpy(reply.ref_id, NTP_KISS_INIT, sizeof(reply.ref_id));
+        }
+        return true;
+    }
+
+#if defined(__linux__)
+    void runBatched(ServerWorker &worker) {
+        struct ReceiveSlot {
+            uint8_t data[SERVER_RECV_BUFFER_SIZE];
+            struct sockaddr_storage addr;
+            alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(struct timespec))];
+        };
+
+        std::vector<ReceiveSlot> slots(SERVER_BATCH_SIZE);
+        std::vector<sntp_packet> replies(SERVER_BATCH_SIZE);
+        std::vector<struct mmsghdr> rx_msgs(SERVER_BATCH_SIZE);
+        std::vector<struct mmsghdr> tx_msgs(SERVER_BATCH_SIZE);
+        std::vector<struct iovec> rx_iovs(SERVER_BATCH_SIZE);
+        std::vector<struct iovec> tx_iovs(SERVER_BATCH_SIZE);
+
+        while (running_.load(std::memory_order_relaxed)) {
+            for (int i = 0; i < SERVER_BATCH_SIZE; i++) {
+                rx_iovs[i].iov_base = slots[i].data;
+                rx_iovs[i].iov_len = sizeof(slots[i].data);
+                struct msghdr &hdr = rx_msgs[i].msg_hdr;
+                memset(&hdr, 0, sizeof(hdr));
+                hdr.msg_name = &slots[i].addr;
+                hdr.msg_namelen = sizeof(slots[i].addr);
+                hdr.msg_iov = &rx_iovs[i];
+                hdr.msg_iovlen = 1;
+                hdr.msg_control = slots[i].control;
+                hdr.msg_controllen = sizeof(slots[i].control);
+            }
+
+            // 阻塞等待第一个包，之后取走队列中已有的包
+            int count = recvmmsg(worker.sockfd, rx_msgs.data(), SERVER_BATCH_SIZE, MSG_WAITFORONE, nullptr);
+            if (count <= 0) {
+                if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    log("receive request failed: %s", strerror(errno));
+                }
+                continue;
+            }
+            worker.requests.fetch_add(count, std::memory_order_relaxed);
+
+            ServerTimeBase base = takeTimeBase();
+            int pending = 0;
+            for (int i = 0; i < count; i++) {
+                sntp_packet &reply = replies[pending];
+                if (!buildReply(slots[i].data, rx_msgs[i].msg_len, base, reply)) {
+                    worker.dropped.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+
+                struct timespec rx_time;
+                bool has_rx_time = kernelReceiveTime(rx_msgs[i].msg_hdr, rx_time);
+                reply.recv_time = toNtpTimestamp(has_rx_time ? serverTimeAt(base, rx_time) : base.server_time);
+
+                tx_iovs[pending].iov_base = &reply;
+                tx_iovs[pending].iov_len = sizeof(reply);
+                struct msghdr &hdr = tx_msgs[pending].msg_hdr;
+                memset(&hdr, 0, sizeof(hdr));
+                hdr.msg_name = &slots[i].addr;
+                hdr.msg_namelen = rx_msgs[i].msg_hdr.msg_namelen;
+                hdr.msg_iov = &tx_iovs[pending];
+                hdr.msg_iovlen = 1;
+                pending++;
+            }
+
+            if (pending == 0) {
+                continue;
+            }
+
+            // 发送时间戳(t3)尽量靠近 sendmmsg
+            struct timespec now;
+            clock_gettime(CLOCK_REALTIME, &now);
+            ntp_timestamp tran_time = toNtpTimestamp(serverTimeAt(base, now));
+            for (int i = 0; i < pending; i++) {
+                replies[i].tran_time = tran_time;
+            }
+
+            int sent = 0;
+            while (sent < pending) {
+                int ret = sendmmsg(worker.sockfd, tx_msgs.data() + sent, pending - sent, 0);
+                if (ret <= 0) {
+                    if (ret < 0 && errno == EINTR) {
+                        continue;
+                    }
+                    log("send response failed: %s", strerror(errno));
+                    break;
+                }
+                sent += ret;
+            }
+            worker.responses.fetch_add(sent, std::memory_order_relaxed);
+        }
+    }
+#else
+    void runSimple(ServerWorker &worker) {
+        uint8_t data[SERVER_RECV_BUFFER_SIZE];
+        struct sockaddr_storage addr;
+        alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(struct timespec))];
+        sntp_packet reply;
+
+        while (running_.load(std::memory_order_relaxed)) {
+            struct iovec iov;
+            iov.iov_base = data;
+            iov.iov_len = sizeof(data);
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_name = &addr;
+            msg.msg_namelen = sizeof(addr);
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+
+            ssize_t size = recvmsg(worker.sockfd, &msg, 0);
+            if (size < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                    log("receive request failed: %s", strerror(errno));
+                }
+                continue;
+            }
+            worker.requests.fetch_add(1, std::memory_order_relaxed);
+
+            ServerTimeBase base = takeTimeBase();
+            if (!buildReply(data, size, base, reply)) {
+                worker.dropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+
+            struct timespec rx_time;
+            bool has_rx_time = kernelReceiveTime(msg, rx_time);
+            reply.recv_time = toNtpTimestamp(has_rx_time ? serverTimeAt(base, rx_time) : base.server_time);
+
+            struct timespec now;
+            clock_gettime(CLOCK_REALTIME, &now);
+            reply.tran_time = toNtpTimestamp(serverTimeAt(base, now));
+
+            if (sendto(worker.sockfd, &reply, sizeof(reply), 0, reinterpret_cast<struct sockaddr *>(&addr), msg.msg_namelen) < 0) {
+                log("send response failed: %s", strerror(errno));
+                continue;
+            }
+            worker.responses.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+#endif
+};
+
+SntpServer::SntpServer(const SntpClient &client)
+    : impl_(std::make_unique<Implement>(client)) {
+}
+
+SntpServer::~SntpServer() {
+}
+
+void SntpServer::setPort(uint16_t port) {
+    impl_->setPort(port);
+}
+
+void SntpServer::setThreads(int threads) {
+    impl_->setThreads(threads);
+}
+
+void SntpServer::setVerbose(bool verbose) {
+    impl_->setVerbose(verbose);
+}
+
+void SntpServer::setLogHandler(LogHandler handler, void *context) {
+    impl_->setLogHandler(handler, context);
+}
+
+bool SntpServer::start() {
+    return impl_->start();
+}
+
+void SntpServer::stop() {
+    impl_->stop();
+}
+
+bool SntpServer::isRunning() const {
+    return impl_->isRunning();
+}
+
+uint64_t SntpServer::getRequestCount() const {
+    return impl_->sumCounter(&ServerWorker::requests);
+}
+
+uint64_t SntpServer::getResponseCount() const {
+    return impl_->sumCounter(&ServerWorker::responses);
+}
+
+uint64_t SntpServer::getDroppedCount() const {
+    return impl_->sumCounter(&ServerWorker::dropped);
+}
+};  // namespace time_sync
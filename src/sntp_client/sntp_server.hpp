@@ -0,0 +1,75 @@
+//
+//  sntp_server.hpp
+//  sntp_client
+//
+//  Created by king on 2024/11/17.
+//
+
+#ifndef sntp_server_hpp
+#define sntp_server_hpp
+
+#include <cstdint>
+#include <memory>
+
+namespace time_sync {
+
+class SntpClient;
+
+/// 以 SntpClient 的时间基准响应局域网内的 SNTP 请求
+class SntpServer {
+  public:
+    /// 日志回调，与 SntpClient::LogHandler 相同
+    /// - Parameters:
+    ///   - message: 单行日志，不含换行
+    ///   - context: setLogHandler 传入的 context
+    using LogHandler = void (*)(const char *message, void *context);
+
+    /// 创建SntpServer
+    /// - Parameter client: 提供时间基准的SntpClient，生命周期需长于SntpServer
+    explicit SntpServer(const SntpClient &client);
+
+    ~SntpServer();
+
+    /// 设置监听端口
+    /// - Parameter port: 默认 123
+    void setPort(uint16_t port);
+
+    /// 设置工作线程数
+    /// - Parameter threads: 默认 0，即CPU核心数；Linux 上每个线程独占一个 SO_REUSEPORT socket
+    void setThreads(int threads);
+
+    /// 启用详细信息输出
+    /// - Parameter verbose:
+    void setVerbose(bool verbose);
+
+    /// 设置日志回调，启用详细信息输出时调用，未设置时输出到 stderr；需在 start() 之前设置
+    /// - Parameters:
+    ///   - handler: 回调，传 nullptr 恢复默认；可能在多个工作线程中并发调用
+    ///   - context: 原样传给回调
+    void setLogHandler(LogHandler handler, void *context = nullptr);
+
+    /// 启动服务
+    bool start();
+
+    /// 停止服务
+    void stop();
+
+    /// 是否正在运行
+    bool isRunning() const;
+
+    /// 已接收的请求数
+    uint64_t getRequestCount() const;
+
+    /// 已发送的响应数
+    uint64_t getResponseCount() const;
+
+    /// 丢弃的无效请求数
+    uint64_t getDroppedCount() const;
+
+  private:
+    class Implement;
+    std::unique_ptr<Implement> impl_;
+};
+};  // namespace time_sync
+
+#endif /* sntp_server_hpp */
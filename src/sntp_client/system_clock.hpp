@@ -8,7 +8,7 @@
 #ifndef system_clock_hpp
 #define system_clock_hpp
 
-#include <memory>
+#include <cstdint>
 
 namespace time_sync {
 
@@ -20,11 +20,16 @@ class SystemClock {
     // 返回从 1970-01-01 00:00:00 UTC 到现在的毫秒数
     virtual uint64_t currentTimeMillis() = 0;
     
-    // 获取自启动以来的时间（毫秒）
+    // 获取自启动以来的时间（毫秒），包含休眠时间
     virtual uint64_t elapsedRealtime() = 0;
+
+    // 获取自启动以来的时间（毫秒），不包含休眠时间
+    // 与 elapsedRealtime 的差值增大说明期间发生过休眠
+    virtual uint64_t uptimeMillis() = 0;
 };
 
-std::unique_ptr<SystemClock> createSystemClock();
+/// 当前平台的时钟，静态存储，进程内共享
+SystemClock &getSystemClock();
 
 };  // namespace time_sync
 
@@ -29,13 +29,23 @@ class WindowsSystemClock : public SystemClock {
 		return 0;
 	}
 
-	// 获取自启动以来的时间（毫秒）
+	// 获取自启动以来的时间（毫秒），包含休眠时间
+	// GetTickCount 49.7 天回绕，使用 64 位版本
 	uint64_t elapsedRealtime() override {
-		return (uint64_t)GetTickCount();
+		return (uint64_t)GetTickCount64();
+	}
+
+	// 获取自启动以来的时间（毫秒），不包含休眠时间
+	uint64_t uptimeMillis() override {
+		ULONGLONG unbiased = 0;
+		QueryUnbiasedInterruptTime(&unbiased);
+		// 单位 100ns
+		return (uint64_t)(unbiased / 10000);
 	}
 };
 
-std::unique_ptr<SystemClock> createSystemClock() {
-	return std::make_unique<WindowsSystemClock>();
+SystemClock &getSystemClock() {
+	static WindowsSystemClock clock;
+	return clock;
 }
 };  // namespace time_sync